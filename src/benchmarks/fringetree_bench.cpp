@@ -0,0 +1,520 @@
+#include <fringetree/chunk.h>
+#include <fringetree/fringetree.h>
+#include <fringetree/ordered.h>
+#include <fringetree/parallel.h>
+#include <fringetree/transient.h>
+#include <fringetree/versioned.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <random>
+#include <set>
+#include <vector>
+
+// Every global allocation is counted so that each benchmark can report the
+// allocations it makes per iteration and the bytes it allocates per element.
+namespace {
+std::atomic<std::size_t> allocations{0};
+std::atomic<std::size_t> allocatedBytes{0};
+} // namespace
+
+auto operator new(std::size_t bytes) -> void* {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (void* p = std::malloc(bytes == 0 ? 1 : bytes)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+using namespace fringetree;
+
+namespace {
+using Tree = Tree<int, int>;
+
+enum Shape { Balanced, LeftSpine, RightSpine };
+
+char const* const shapeNames[] = {"balanced", "left-spine", "right-spine"};
+
+// Spines are built directly with 'Tree::branch', which does not rebalance, so
+// every level holds one leaf.
+auto make(Shape shape, int n) -> Ptr<Tree> {
+    auto t = Tree::empty();
+    switch (shape) {
+    case Balanced:
+        for (int i = 0; i < n; ++i) {
+            t = append(i, t);
+        }
+        break;
+    case LeftSpine:
+        for (int i = 0; i < n; ++i) {
+            t = Tree::branch(t, Tree::leaf(i));
+        }
+        break;
+    case RightSpine:
+        for (int i = n; i-- > 0;) {
+            t = Tree::branch(Tree::leaf(i), t);
+        }
+        break;
+    }
+    return t;
+}
+
+// Reports what was allocated between construction and destruction, averaged
+// over the benchmark's iterations.
+class AllocationCounter {
+  private:
+    benchmark::State& state_;
+    std::size_t       elements_;
+    std::size_t       allocations_;
+    std::size_t       bytes_;
+
+  public:
+    AllocationCounter(benchmark::State& state, std::size_t elements)
+        : state_(state),
+          elements_(elements == 0 ? 1 : elements),
+          allocations_(allocations.load(std::memory_order_relaxed)),
+          bytes_(allocatedBytes.load(std::memory_order_relaxed)) {}
+
+    ~AllocationCounter() {
+        auto count = allocations.load(std::memory_order_relaxed) -
+                     allocations_;
+        auto bytes = allocatedBytes.load(std::memory_order_relaxed) - bytes_;
+        state_.counters["allocs/op"] = benchmark::Counter(
+            double(count), benchmark::Counter::kAvgIterations);
+        state_.counters["bytes/elem"] = benchmark::Counter(
+            double(bytes) / double(elements_),
+            benchmark::Counter::kAvgIterations);
+    }
+};
+
+// Every shape runs up to 2^18 leaves.  No operation recurses along a path,
+// so a spine of that depth needs no more stack than a balanced tree.
+void shapes(benchmark::internal::Benchmark* b) {
+    for (int n = 8; n <= (1 << 18); n *= 8) {
+        b->Args({Balanced, n});
+        b->Args({LeftSpine, n});
+        b->Args({RightSpine, n});
+    }
+}
+
+void sizes(benchmark::internal::Benchmark* b) {
+    b->RangeMultiplier(8)->Range(8, 1 << 18);
+}
+
+void BM_append(benchmark::State& state) {
+    auto              n = int(state.range(0));
+    AllocationCounter counter(state, n);
+    for (auto _ : state) {
+        auto t = Tree::empty();
+        for (int i = 0; i < n; ++i) {
+            t = append(i, t);
+        }
+        benchmark::DoNotOptimize(t);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_append)->Apply(sizes);
+
+void BM_prepend(benchmark::State& state) {
+    auto              n = int(state.range(0));
+    AllocationCounter counter(state, n);
+    for (auto _ : state) {
+        auto t = Tree::empty();
+        for (int i = 0; i < n; ++i) {
+            t = prepend(i, t);
+        }
+        benchmark::DoNotOptimize(t);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_prepend)->Apply(sizes);
+
+void BM_fromRange(benchmark::State& state) {
+    auto             n = int(state.range(0));
+    std::vector<int> values(n);
+    std::iota(values.begin(), values.end(), 0);
+    AllocationCounter counter(state, n);
+    for (auto _ : state) {
+        auto t = Tree::from_range(values.begin(), values.end());
+        benchmark::DoNotOptimize(t);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_fromRange)->Apply(sizes);
+
+void BM_transientAppend(benchmark::State& state) {
+    auto              n = int(state.range(0));
+    AllocationCounter counter(state, n);
+    for (auto _ : state) {
+        Transient<Tree> transient;
+        for (int i = 0; i < n; ++i) {
+            transient.push_back(i);
+        }
+        auto t = transient.persistent();
+        benchmark::DoNotOptimize(t);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_transientAppend)->Apply(sizes);
+
+// Joins a tree of 'n' leaves to one of 'n / ratio' leaves.
+void BM_concat(benchmark::State& state) {
+    auto              n     = int(state.range(0));
+    auto              ratio = int(state.range(1));
+    auto              l     = make(Balanced, n);
+    auto              r     = make(Balanced, n / ratio);
+    AllocationCounter counter(state, n + n / ratio);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(concat(l, r));
+        benchmark::DoNotOptimize(concat(r, l));
+    }
+}
+BENCHMARK(BM_concat)->ArgsProduct({{64, 4096, 1 << 18}, {1, 8, 64}});
+
+void BM_drain(benchmark::State& state) {
+    auto              shape = Shape(state.range(0));
+    auto              n     = int(state.range(1));
+    auto              tree  = make(shape, n);
+    AllocationCounter counter(state, n);
+    for (auto _ : state) {
+        for (auto t = tree; !t->isEmpty(); t = tail(t)) {
+            benchmark::DoNotOptimize(head(t));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.SetLabel(shapeNames[shape]);
+}
+BENCHMARK(BM_drain)->Apply(shapes);
+
+void BM_peek(benchmark::State& state) {
+    auto              shape = Shape(state.range(0));
+    auto              n     = int(state.range(1));
+    auto              tree  = make(shape, n);
+    AllocationCounter counter(state, n);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(is_empty(tree));
+        benchmark::DoNotOptimize(head(tree));
+        benchmark::DoNotOptimize(last(tree));
+    }
+    state.SetLabel(shapeNames[shape]);
+}
+BENCHMARK(BM_peek)->Apply(shapes);
+
+void BM_flatten(benchmark::State& state) {
+    auto              shape = Shape(state.range(0));
+    auto              n     = int(state.range(1));
+    auto              tree  = make(shape, n);
+    AllocationCounter counter(state, n);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(flatten(tree));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.SetLabel(shapeNames[shape]);
+}
+BENCHMARK(BM_flatten)->Apply(shapes);
+
+void BM_depth(benchmark::State& state) {
+    auto              shape = Shape(state.range(0));
+    auto              n     = int(state.range(1));
+    auto              tree  = make(shape, n);
+    AllocationCounter counter(state, n);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(depth(tree));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.SetLabel(shapeNames[shape]);
+}
+BENCHMARK(BM_depth)->Apply(shapes);
+
+void BM_breadth(benchmark::State& state) {
+    auto              shape = Shape(state.range(0));
+    auto              n     = int(state.range(1));
+    auto              tree  = make(shape, n);
+    AllocationCounter counter(state, n);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(breadth(tree));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.SetLabel(shapeNames[shape]);
+}
+BENCHMARK(BM_breadth)->Apply(shapes);
+
+// Scans of a plain tree, a chunked tree and a vector holding the same values.
+using Chunked = ChunkedTree<int>;
+
+auto makeChunked(int n) -> Ptr<Chunked> {
+    std::vector<int> values(n);
+    std::iota(values.begin(), values.end(), 0);
+    return chunk_from_range<Chunked>(values.begin(), values.end());
+}
+
+void BM_iterate(benchmark::State& state) {
+    auto              n    = int(state.range(0));
+    auto              tree = make(Balanced, n);
+    AllocationCounter counter(state, n);
+    for (auto _ : state) {
+        long sum = 0;
+        for (auto v : *tree) {
+            sum += v;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_iterate)->Apply(sizes);
+
+void BM_chunkedIterate(benchmark::State& state) {
+    auto n    = int(state.range(0));
+    auto tree = makeChunked(n);
+    for (auto _ : state) {
+        long sum = 0;
+        for (auto v : chunk_values(tree)) {
+            sum += v;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_chunkedIterate)->Apply(sizes);
+
+void BM_vectorIterate(benchmark::State& state) {
+    auto             n = int(state.range(0));
+    std::vector<int> values(n);
+    std::iota(values.begin(), values.end(), 0);
+    for (auto _ : state) {
+        long sum = 0;
+        for (auto v : values) {
+            sum += v;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_vectorIterate)->Apply(sizes);
+
+void BM_chunkedFlatten(benchmark::State& state) {
+    auto              n    = int(state.range(0));
+    auto              tree = makeChunked(n);
+    AllocationCounter counter(state, n);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(chunk_flatten(tree));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_chunkedFlatten)->Apply(sizes);
+
+// The same values, built one way by appending and the other all at once, so
+// that no subtree is shared.
+void BM_sameFringe(benchmark::State& state) {
+    auto             n = int(state.range(0));
+    std::vector<int> values(n);
+    std::iota(values.begin(), values.end(), 0);
+    auto a = make(Balanced, n);
+    auto b = Tree::from_range(values.begin(), values.end());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(same_fringe(a, b));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_sameFringe)->Apply(sizes);
+
+void BM_chunkedSameFringe(benchmark::State& state) {
+    auto n = int(state.range(0));
+    auto a = Chunked::empty();
+    for (int i = 0; i < n; ++i) {
+        a = chunk_append(i, a);
+    }
+    auto b = makeChunked(n);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(chunk_same_fringe(a, b));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_chunkedSameFringe)->Apply(sizes);
+
+struct Sum {
+    static auto identity() -> long { return 0; }
+    static auto leaf(int v) -> long { return v; }
+    static auto combine(long a, long b) -> long { return a + b; }
+};
+
+// The sequential baseline for 'BM_parallelReduce': a left fold of the same
+// monoid over the leaves in order.
+void BM_reduce(benchmark::State& state) {
+    auto n    = int(state.range(0));
+    auto tree = make(Balanced, n);
+    for (auto _ : state) {
+        auto sum = Sum::identity();
+        for (auto v : *tree) {
+            sum = Sum::combine(sum, Sum::leaf(v));
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_reduce)->Apply(sizes);
+
+void BM_parallelReduce(benchmark::State& state) {
+    auto n    = int(state.range(0));
+    auto tree = make(Balanced, n);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parallel_reduce(tree, Sum{}));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_parallelReduce)->Apply(sizes)->UseRealTime();
+
+void BM_parallelMap(benchmark::State& state) {
+    auto              n    = int(state.range(0));
+    auto              tree = make(Balanced, n);
+    AllocationCounter counter(state, n);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            parallel_map(tree, [](int i) { return 2.0 * i; }));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_parallelMap)->Apply(sizes)->UseRealTime();
+
+// Thread 0 commits a new version on every iteration, keeping the size fixed,
+// while every other thread takes snapshots and reads both ends.  Compared
+// with the same workload on a shared pointer behind a mutex.
+constexpr int storeSize = 4096;
+
+void BM_versioned(benchmark::State& state) {
+    static Versioned<Tree> store(make(Balanced, storeSize));
+    for (auto _ : state) {
+        if (state.thread_index() == 0) {
+            store.update([](auto t) { return append(head(t), tail(t)); });
+        } else {
+            auto v = store.snapshot();
+            benchmark::DoNotOptimize(head(v->root()) + last(v->root()));
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_versioned)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_mutexRoot(benchmark::State& state) {
+    static std::mutex mutex;
+    static auto       root = make(Balanced, storeSize);
+    for (auto _ : state) {
+        if (state.thread_index() == 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            root = append(head(root), tail(root));
+        } else {
+            Ptr<Tree> t;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                t = root;
+            }
+            benchmark::DoNotOptimize(head(t) + last(t));
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_mutexRoot)->ThreadRange(1, 8)->UseRealTime();
+
+// Every thread commits, so commits conflict and retry.
+void BM_versionedWriters(benchmark::State& state) {
+    static Versioned<Tree> store(make(Balanced, storeSize));
+    for (auto _ : state) {
+        store.update([](auto t) { return append(head(t), tail(t)); });
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_versionedWriters)->ThreadRange(1, 8)->UseRealTime();
+
+// A batch of 64 updates committed as one version.
+void BM_versionedBatch(benchmark::State& state) {
+    static Versioned<Tree> store(make(Balanced, storeSize));
+    for (auto _ : state) {
+        store.transact([](Transient<Tree>& t) {
+            for (int i = 0; i < 64; ++i) {
+                t.push_back(i);
+            }
+        });
+        if (state.thread_index() == 0) {
+            store.update([](auto t) {
+                return t->size() > 4 * storeSize ? make(Balanced, storeSize)
+                                                 : t;
+            });
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 64);
+}
+BENCHMARK(BM_versionedBatch)->ThreadRange(1, 8)->UseRealTime();
+
+// Keyed inserts and lookups in random order on an ordered set, next to
+// 'std::set', which is not persistent and so copies nothing.
+auto randomKeys(int n) {
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+    return keys;
+}
+
+void BM_orderedInsert(benchmark::State& state) {
+    auto              keys = randomKeys(int(state.range(0)));
+    AllocationCounter counter(state, int(keys.size()));
+    for (auto _ : state) {
+        auto s = OrderedSet<int>::empty();
+        for (auto k : keys) {
+            s = ordered_insert(k, s);
+        }
+        benchmark::DoNotOptimize(s);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_orderedInsert)->Apply(sizes);
+
+void BM_stdSetInsert(benchmark::State& state) {
+    auto keys = randomKeys(int(state.range(0)));
+    for (auto _ : state) {
+        std::set<int> s;
+        for (auto k : keys) {
+            s.insert(k);
+        }
+        benchmark::DoNotOptimize(s);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_stdSetInsert)->Apply(sizes);
+
+void BM_orderedFind(benchmark::State& state) {
+    auto keys = randomKeys(int(state.range(0)));
+    auto s    = ordered_from_range<OrderedSet<int>>(keys.begin(), keys.end());
+    for (auto _ : state) {
+        for (auto k : keys) {
+            benchmark::DoNotOptimize(ordered_find(s, k));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_orderedFind)->Apply(sizes);
+
+void BM_stdSetFind(benchmark::State& state) {
+    auto          keys = randomKeys(int(state.range(0)));
+    std::set<int> s(keys.begin(), keys.end());
+    for (auto _ : state) {
+        for (auto k : keys) {
+            benchmark::DoNotOptimize(s.find(k));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_stdSetFind)->Apply(sizes);
+} // namespace
+
+BENCHMARK_MAIN();
@@ -1,4 +1,5 @@
 #include <fringetree/fringetree.h>
+#include <fringetree/hashcons.h>
 
 #include <iostream>
 
@@ -24,14 +25,16 @@ int main(int /*argc*/, char** /*argv*/)
     t2->visit(p);
     std::cout << "}\n";
 
-    auto left = Tree::branch(
-        Tree::branch(Tree::leaf(1), Tree::leaf(2)),
-        Tree::leaf(3)
+    // Built through one factory, equal trees are the same nodes.
+    HashCons<Tree> nodes;
+    auto left = nodes.branch(
+        nodes.branch(nodes.leaf(1), nodes.leaf(2)),
+        nodes.leaf(3)
         );
 
-    auto right = Tree::branch(
-        Tree::branch(Tree::leaf(1), Tree::leaf(2)),
-        Tree::leaf(3)
+    auto right = nodes.branch(
+        nodes.branch(nodes.leaf(1), nodes.leaf(2)),
+        nodes.leaf(3)
         );
 
     auto c = concat(left, right);
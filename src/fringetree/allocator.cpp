@@ -0,0 +1,22 @@
+// allocator.cpp                                                      -*-C++-*-
+#include <fringetree/allocator.h>
+
+namespace fringetree {
+
+namespace {
+thread_local std::pmr::memory_resource* currentResource =
+    std::pmr::new_delete_resource();
+} // namespace
+
+auto current_resource() -> std::pmr::memory_resource* {
+    return currentResource;
+}
+
+ResourceScope::ResourceScope(std::pmr::memory_resource* resource)
+    : previous_(currentResource) {
+    currentResource = resource;
+}
+
+ResourceScope::~ResourceScope() { currentResource = previous_; }
+
+} // namespace fringetree
@@ -0,0 +1,202 @@
+// allocator.h                                                        -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_ALLOCATOR
+#define INCLUDED_FRINGETREE_ALLOCATOR
+
+#include <fringetree/fringetree.h>
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace fringetree {
+
+// The memory resource that nodes created on the calling thread are allocated
+// from.  Defaults to 'std::pmr::new_delete_resource()'.
+auto current_resource() -> std::pmr::memory_resource*;
+
+// Makes 'resource' the current resource of the calling thread for the
+// lifetime of the scope, restoring the previous one on exit.
+class ResourceScope {
+    std::pmr::memory_resource* previous_;
+
+  public:
+    explicit ResourceScope(std::pmr::memory_resource* resource);
+    ~ResourceScope();
+
+    ResourceScope(ResourceScope const&) = delete;
+    ResourceScope& operator=(ResourceScope const&) = delete;
+};
+
+// An allocator that, when default constructed, captures the calling
+// thread's current resource.  'Tree' default constructs its allocator for
+// each node, and 'std::allocate_shared' keeps the copy in the control block,
+// so a node is always returned to the resource it came from, whichever
+// thread releases it.
+template <typename T>
+class ResourceAllocator {
+    std::pmr::memory_resource* resource_;
+
+  public:
+    using value_type = T;
+
+    ResourceAllocator() noexcept : resource_(current_resource()) {}
+
+    explicit ResourceAllocator(std::pmr::memory_resource* resource) noexcept
+        : resource_(resource) {}
+
+    template <typename U>
+    ResourceAllocator(ResourceAllocator<U> const& other) noexcept
+        : resource_(other.resource()) {}
+
+    auto allocate(std::size_t n) -> T* {
+        return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) {
+        resource_->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    auto resource() const -> std::pmr::memory_resource* { return resource_; }
+
+    template <typename U>
+    friend bool operator==(ResourceAllocator const&    lhs,
+                           ResourceAllocator<U> const& rhs) {
+        return lhs.resource() == rhs.resource() ||
+               lhs.resource()->is_equal(*rhs.resource());
+    }
+
+    template <typename U>
+    friend bool operator!=(ResourceAllocator const&    lhs,
+                           ResourceAllocator<U> const& rhs) {
+        return !(lhs == rhs);
+    }
+};
+
+template <typename Tag, typename Value, typename Measure = SizeMeasure<Tag>>
+using PmrTree = Tree<Tag, Value, Measure, ResourceAllocator<Value>>;
+
+// An upper bound on the block 'std::allocate_shared' asks for to hold one
+// node of 'Tree' together with its control block and allocator.
+template <typename Tree>
+constexpr std::size_t node_size = sizeof(Tree) + 4 * sizeof(void*);
+
+// A single-threaded pool of node-sized blocks.  Blocks are carved from
+// chunks of 'nodesPerChunk' nodes obtained from 'upstream' and recycled
+// through a free list, so allocating or freeing a node is a couple of
+// pointer moves.  Requests larger than a node are passed through upstream.
+// All chunks are returned when the pool is released or destroyed.
+template <typename Tree>
+class NodePool : public std::pmr::memory_resource {
+    static constexpr std::size_t align_ = alignof(std::max_align_t);
+    static constexpr std::size_t block_ =
+        (node_size<Tree> + align_ - 1) / align_ * align_;
+
+    struct Free {
+        Free* next_;
+    };
+
+    struct Chunk {
+        Chunk*      next_;
+        std::size_t bytes_;
+    };
+
+    static constexpr std::size_t header_ =
+        (sizeof(Chunk) + align_ - 1) / align_ * align_;
+
+    std::pmr::memory_resource* upstream_;
+    std::size_t                nodesPerChunk_;
+    Free*                      free_;
+    Chunk*                     chunks_;
+
+    static bool pooled(std::size_t bytes, std::size_t align) {
+        return bytes <= block_ && align <= align_;
+    }
+
+    void refill() {
+        auto  bytes = header_ + nodesPerChunk_ * block_;
+        auto* chunk = static_cast<Chunk*>(upstream_->allocate(bytes, align_));
+        chunk->next_  = chunks_;
+        chunk->bytes_ = bytes;
+        chunks_       = chunk;
+
+        auto* first = reinterpret_cast<std::byte*>(chunk) + header_;
+        for (auto i = nodesPerChunk_; i-- != 0;) {
+            auto* block  = reinterpret_cast<Free*>(first + i * block_);
+            block->next_ = free_;
+            free_        = block;
+        }
+    }
+
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        if (!pooled(bytes, align)) {
+            return upstream_->allocate(bytes, align);
+        }
+        if (free_ == nullptr) {
+            refill();
+        }
+        auto* block = free_;
+        free_       = block->next_;
+        return block;
+    }
+
+    void
+    do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+        if (!pooled(bytes, align)) {
+            upstream_->deallocate(p, bytes, align);
+            return;
+        }
+        auto* block  = static_cast<Free*>(p);
+        block->next_ = free_;
+        free_        = block;
+    }
+
+    bool do_is_equal(memory_resource const& other) const noexcept override {
+        return this == &other;
+    }
+
+  public:
+    explicit NodePool(
+        std::size_t                nodesPerChunk = 1024,
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream_(upstream),
+          nodesPerChunk_(nodesPerChunk),
+          free_(nullptr),
+          chunks_(nullptr) {}
+
+    NodePool(NodePool const&) = delete;
+    NodePool& operator=(NodePool const&) = delete;
+
+    ~NodePool() override { release(); }
+
+    // Returns every chunk upstream.  No node allocated from the pool may be
+    // alive.
+    void release() {
+        while (chunks_ != nullptr) {
+            auto* next = chunks_->next_;
+            upstream_->deallocate(chunks_, chunks_->bytes_, align_);
+            chunks_ = next;
+        }
+        free_ = nullptr;
+    }
+
+    auto upstream_resource() const -> std::pmr::memory_resource* {
+        return upstream_;
+    }
+};
+
+// A monotonic arena sized for 'nodes' nodes of 'Tree'.  Freeing a node is a
+// no-op; everything allocated is released at once by 'release()' or on
+// destruction, which must not happen while any tree allocated from the
+// arena is still alive.
+template <typename Tree>
+class NodeArena : public std::pmr::monotonic_buffer_resource {
+  public:
+    explicit NodeArena(
+        std::size_t                nodes    = 1024,
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : std::pmr::monotonic_buffer_resource(nodes * node_size<Tree>,
+                                              upstream) {}
+};
+
+} // namespace fringetree
+
+#endif
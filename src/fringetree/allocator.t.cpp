@@ -0,0 +1,97 @@
+#include <fringetree/allocator.h>
+#include <fringetree/testsupport.t.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+
+using namespace fringetree;
+using namespace fringetree::test;
+
+TEST(AllocatorTest, defaultResource) {
+    using Tree = PmrTree<int, int>;
+    ASSERT_EQ(std::pmr::new_delete_resource(), current_resource());
+
+    auto t = build<Tree>(0, 100);
+    ASSERT_EQ(100u, t->size());
+    ASSERT_EQ(99, last(t));
+}
+
+TEST(AllocatorTest, scopedResource) {
+    using Tree = PmrTree<int, int>;
+    CountingResource counting;
+
+    std::shared_ptr<Tree> t;
+    {
+        ResourceScope scope(&counting);
+        ASSERT_EQ(&counting, current_resource());
+        t = build<Tree>(0, 100);
+    }
+    ASSERT_EQ(std::pmr::new_delete_resource(), current_resource());
+    ASSERT_GT(counting.allocations_, 100);
+    ASSERT_LE(counting.largest_, node_size<Tree>);
+
+    auto more = append(100, t);
+    auto made = counting.allocations_;
+    ASSERT_EQ(101u, more->size());
+
+    t.reset();
+    more.reset();
+    ASSERT_EQ(made, counting.allocations_);
+    ASSERT_EQ(counting.allocations_, counting.deallocations_);
+}
+
+TEST(AllocatorTest, nestedScopes) {
+    CountingResource outer;
+    CountingResource inner;
+    {
+        ResourceScope s1(&outer);
+        {
+            ResourceScope s2(&inner);
+            ASSERT_EQ(&inner, current_resource());
+        }
+        ASSERT_EQ(&outer, current_resource());
+    }
+    ASSERT_EQ(std::pmr::new_delete_resource(), current_resource());
+}
+
+TEST(AllocatorTest, nodePool) {
+    using Tree = PmrTree<int, int>;
+    CountingResource upstream;
+    {
+        NodePool<Tree> pool(256, &upstream);
+        ResourceScope  scope(&pool);
+
+        auto t = build<Tree>(0, 5000);
+        ASSERT_EQ(5000u, t->size());
+        ASSERT_LT(upstream.allocations_, 200);
+
+        auto before = upstream.allocations_;
+        t.reset();
+        t = build<Tree>(0, 5000);
+        ASSERT_LE(upstream.allocations_, before + 10);
+    }
+    ASSERT_EQ(upstream.allocations_, upstream.deallocations_);
+}
+
+TEST(AllocatorTest, nodeArena) {
+    using Tree = PmrTree<long, int, SizeMeasure<long>>;
+    CountingResource upstream;
+    {
+        NodeArena<Tree> arena(4096, &upstream);
+        {
+            ResourceScope scope(&arena);
+            auto          a = build<Tree>(0, 1000);
+            auto          b = build<Tree>(1000, 2000);
+            auto          c = concat(a, b);
+
+            std::vector<int> expected(2000);
+            std::iota(expected.begin(), expected.end(), 0);
+            ASSERT_EQ(expected, flatten(c));
+        }
+        ASSERT_LT(upstream.allocations_, 10);
+        arena.release();
+        ASSERT_EQ(upstream.allocations_, upstream.deallocations_);
+    }
+}
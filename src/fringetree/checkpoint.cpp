@@ -0,0 +1,2 @@
+// checkpoint.cpp                                                     -*-C++-*-
+#include <fringetree/checkpoint.h>
@@ -0,0 +1,307 @@
+// checkpoint.h                                                       -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_CHECKPOINT
+#define INCLUDED_FRINGETREE_CHECKPOINT
+
+#include <fringetree/fringetree.h>
+#include <fringetree/image.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fringetree {
+
+// A node log records a sequence of versions of a tree, each as the nodes that
+// no earlier checkpoint wrote followed by its root.  Versions built from one
+// another share most of their nodes, so a checkpoint costs what changed
+// since the last one rather than the size of the tree.
+//
+// The log starts with an 'ImageHeader' carrying its own magic.  Each
+// checkpoint is a 'LogCheckpoint' followed by its node records.  Nodes are
+// numbered in the order they are written, from 1, and 0 is the empty tree.
+// A branch names its children by number, so it may refer to nodes of any
+// earlier checkpoint.  A checkpoint is written with a single call to
+// 'write', and a reader ignores a final checkpoint that was cut short, so a
+// crash while logging loses at most the version being written.
+//
+// A log carried on after such a crash is written from the end of its last
+// complete checkpoint.  The bytes of the one cut short are covered by a
+// 'LogCheckpoint' marked 'skip', whose 'nodes_' is the number of bytes that
+// follow it and are to be passed over.
+
+struct LogCheckpoint {
+    static constexpr std::uint64_t marker = 0x54504b4345474e46;
+    static constexpr std::uint64_t skip   = 0x50494b5345474e46;
+
+    std::uint64_t marker_;
+    std::uint64_t nodes_;
+    std::uint64_t root_;
+};
+
+template <typename Value>
+struct LogRecord {
+    static_assert(std::is_trivially_copyable_v<Value>,
+                  "node logs hold values as raw bytes");
+
+    struct Children {
+        std::uint64_t left_;
+        std::uint64_t right_;
+    };
+
+    // 1 for a leaf, or a branch's leaf count.
+    std::uint64_t size_;
+    union {
+        Children children_;
+        Value    value_;
+    };
+
+    LogRecord() : size_(0), children_{0, 0} {}
+};
+
+constexpr char node_log_magic[8] = {'F', 'R', 'I', 'N', 'G', 'L', 'O', 'G'};
+
+// The versions in a node log, with every node rebuilt once and shared
+// wherever the log shares it.  'nodes_' is indexed by node number and
+// 'end_' is the offset just past the last complete checkpoint, counted from
+// the start of the log.  They are what 'NodeLog' needs to carry on writing
+// the same log.
+template <typename Tree>
+struct NodeLogContents {
+    std::vector<typename Tree::Ptr_> nodes_;
+    std::vector<typename Tree::Ptr_> versions_;
+    std::uint64_t                    end_ = 0;
+};
+
+// Appends checkpoints to a node log.  The log remembers every node it has
+// written, holding a reference to each so that its address cannot be reused
+// by a different node.  'trim' lets go of nodes nothing else refers to; if
+// one of them turns up again it is simply written again.
+//
+// If the stream fails, the checkpoint being written is forgotten and
+// 'std::runtime_error' is thrown.  What reached the log can be read back
+// and carried on from as after a crash.
+template <typename Tree>
+class NodeLog {
+    using Ptr_    = typename Tree::Ptr_;
+    using Value_  = typename Tree::Value_;
+    using Record_ = LogRecord<Value_>;
+
+    struct Written {
+        std::uint64_t number_;
+        Ptr_          node_;
+    };
+
+    std::ostream&                            os_;
+    std::unordered_map<Tree const*, Written> written_;
+    std::uint64_t                            next_ = 1;
+
+    auto number(Tree const* node) const -> std::uint64_t {
+        return node->isEmpty() ? 0 : written_.at(node).number_;
+    }
+
+    static void fail(char const* what) {
+        throw std::runtime_error(std::string("fringetree::NodeLog: ") + what);
+    }
+
+  public:
+    // Starts a new log on 'os'.
+    explicit NodeLog(std::ostream& os) : os_(os) {
+        ImageHeader header{};
+        std::memcpy(header.magic_, node_log_magic, sizeof header.magic_);
+        header.version_    = ImageHeader::version;
+        header.order_      = ImageHeader::order;
+        header.recordSize_ = sizeof(Record_);
+        header.valueSize_  = sizeof(Value_);
+        os_.write(reinterpret_cast<char const*>(&header), sizeof header);
+        if (!os_.flush()) {
+            fail("cannot write the header");
+        }
+    }
+
+    // Carries on the log 'existing' was read from, which 'os' writes to from
+    // its start.  'os' must be positionable.  Anything after the last
+    // complete checkpoint is passed over by a 'skip' record and then left
+    // behind, since a stream cannot be shortened.
+    NodeLog(std::ostream& os, NodeLogContents<Tree> const& existing)
+        : os_(os), next_(existing.nodes_.size()) {
+        auto end = std::streamoff(existing.end_);
+        if (!os_.seekp(0, std::ios::end)) {
+            fail("cannot position the log");
+        }
+        auto length = std::streamoff(os_.tellp());
+        if (length < end) {
+            fail("the log is shorter than when it was read");
+        }
+        os_.seekp(end);
+        if (length > end) {
+            auto          stale = std::uint64_t(length - end);
+            LogCheckpoint skip{LogCheckpoint::skip,
+                               stale > sizeof skip ? stale - sizeof skip : 0,
+                               0};
+            os_.write(reinterpret_cast<char const*>(&skip), sizeof skip);
+            os_.seekp(std::max(length, end + std::streamoff(sizeof skip)));
+        }
+        if (!os_.flush()) {
+            fail("cannot position the log");
+        }
+        for (std::uint64_t i = 1; i < existing.nodes_.size(); ++i) {
+            auto const& node = existing.nodes_[i];
+            written_.emplace(node.get(), Written{i, node});
+        }
+    }
+
+    NodeLog(NodeLog const&)                    = delete;
+    auto operator=(NodeLog const&) -> NodeLog& = delete;
+
+    // Appends 'root' as the next version and returns how many nodes that
+    // took.  Subtrees already in the log are not entered.
+    auto checkpoint(Ptr_ const& root) -> std::size_t {
+        std::vector<Tree const*>                   fresh;
+        std::vector<std::pair<Ptr_ const*, bool>> stack;
+        if (!root->isEmpty()) {
+            stack.push_back({&root, false});
+        }
+        while (!stack.empty()) {
+            auto [node, expanded] = stack.back();
+            stack.pop_back();
+            if (written_.count(node->get()) != 0) {
+                continue;
+            }
+            auto const* b = (*node)->asBranch();
+            if (b != nullptr && !expanded) {
+                stack.push_back({node, true});
+                stack.push_back({&b->right(), false});
+                stack.push_back({&b->left(), false});
+                continue;
+            }
+            written_.emplace(node->get(), Written{next_++, *node});
+            fresh.push_back(node->get());
+        }
+
+        LogCheckpoint checkpoint{
+            LogCheckpoint::marker, fresh.size(), number(root.get())};
+        std::string block(
+            sizeof checkpoint + fresh.size() * sizeof(Record_), '\0');
+        std::memcpy(block.data(), &checkpoint, sizeof checkpoint);
+        auto* out = block.data() + sizeof checkpoint;
+        for (auto const* node : fresh) {
+            Record_ record;
+            if (auto const* b = node->asBranch()) {
+                record.size_     = b->size();
+                record.children_ = {number(b->left().get()),
+                                    number(b->right().get())};
+            } else {
+                record.size_  = 1;
+                record.value_ = node->asLeaf()->value();
+            }
+            std::memcpy(out, &record, sizeof record);
+            out += sizeof record;
+        }
+        os_.write(block.data(), std::streamsize(block.size()));
+        if (!os_.flush()) {
+            for (auto const* node : fresh) {
+                written_.erase(node);
+            }
+            next_ -= fresh.size();
+            fail("cannot write a checkpoint");
+        }
+        return fresh.size();
+    }
+
+    // Forgets nodes that only the log refers to.
+    void trim() {
+        for (bool freed = true; freed;) {
+            freed = false;
+            for (auto it = written_.begin(); it != written_.end();) {
+                if (it->second.node_.use_count() == 1) {
+                    it    = written_.erase(it);
+                    freed = true;
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    // The number of nodes the log is holding on to.
+    auto nodes() const -> std::size_t { return written_.size(); }
+};
+
+// Reads every complete checkpoint of a node log.
+template <typename Tree>
+auto read_node_log(std::istream& is) -> NodeLogContents<Tree> {
+    using Record_ = LogRecord<typename Tree::Value_>;
+    auto fail     = [](char const* what) {
+        throw std::runtime_error(std::string("fringetree::read_node_log: ") +
+                                 what);
+    };
+
+    ImageHeader header;
+    if (!is.read(reinterpret_cast<char*>(&header), sizeof header) ||
+        std::memcmp(header.magic_, node_log_magic, sizeof header.magic_) !=
+            0 ||
+        header.version_ != ImageHeader::version) {
+        fail("not a node log");
+    }
+    if (header.order_ != ImageHeader::order ||
+        header.recordSize_ != sizeof(Record_) ||
+        header.valueSize_ != sizeof(typename Tree::Value_)) {
+        fail("written with a different layout");
+    }
+
+    NodeLogContents<Tree> contents;
+    contents.nodes_.push_back(Tree::empty());
+    contents.end_ = sizeof header;
+    LogCheckpoint checkpoint;
+    while (is.read(reinterpret_cast<char*>(&checkpoint), sizeof checkpoint)) {
+        if (checkpoint.marker_ == LogCheckpoint::skip) {
+            is.ignore(std::streamsize(checkpoint.nodes_));
+            if (std::uint64_t(is.gcount()) != checkpoint.nodes_) {
+                break;
+            }
+            contents.end_ += sizeof checkpoint + checkpoint.nodes_;
+            continue;
+        }
+        if (checkpoint.marker_ != LogCheckpoint::marker) {
+            fail("corrupt checkpoint");
+        }
+        std::vector<Record_> records(checkpoint.nodes_);
+        auto bytes = std::streamsize(records.size() * sizeof(Record_));
+        if (!is.read(reinterpret_cast<char*>(records.data()), bytes)) {
+            break;
+        }
+        for (auto const& record : records) {
+            auto n = contents.nodes_.size();
+            if (record.size_ == 1) {
+                contents.nodes_.push_back(Tree::leaf(record.value_));
+            } else if (record.children_.left_ < n &&
+                       record.children_.right_ < n) {
+                contents.nodes_.push_back(
+                    Tree::branch(contents.nodes_[record.children_.left_],
+                                 contents.nodes_[record.children_.right_]));
+            } else {
+                fail("corrupt node");
+            }
+        }
+        if (checkpoint.root_ >= contents.nodes_.size()) {
+            fail("corrupt root");
+        }
+        contents.versions_.push_back(contents.nodes_[checkpoint.root_]);
+        contents.end_ += sizeof checkpoint + std::uint64_t(bytes);
+    }
+    return contents;
+}
+
+} // namespace fringetree
+
+#endif
@@ -0,0 +1,174 @@
+#include <fringetree/checkpoint.h>
+#include <fringetree/testsupport.t.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace fringetree;
+using namespace fringetree::test;
+
+TEST(CheckpointTest, writesOnlyNewNodes) {
+    using Tree = Tree<int, int>;
+    std::stringstream log;
+    NodeLog<Tree>     writer(log);
+
+    auto v  = values(1000);
+    auto t0 = Tree::from_range(v.begin(), v.end());
+    ASSERT_EQ(1999u, writer.checkpoint(t0));
+    auto size = log.str().size();
+
+    auto t1 = append(1000, t0);
+    auto n1 = writer.checkpoint(t1);
+    ASSERT_LT(n1, 2 * depth(t1) + 2);
+
+    auto t2 = concat(t1, t0);
+    ASSERT_LT(writer.checkpoint(t2), 4 * depth(t2));
+    ASSERT_EQ(0u, writer.checkpoint(t0));
+    ASSERT_EQ(0u, writer.checkpoint(Tree::empty()));
+    ASSERT_LT(log.str().size() - size, size / 10);
+
+    auto contents = read_node_log<Tree>(log);
+    ASSERT_EQ(5u, contents.versions_.size());
+    ASSERT_TRUE(same_fringe(t0, contents.versions_[0]));
+    ASSERT_TRUE(same_fringe(t1, contents.versions_[1]));
+    ASSERT_TRUE(same_fringe(t2, contents.versions_[2]));
+    ASSERT_EQ(contents.versions_[0], contents.versions_[3]);
+    ASSERT_TRUE(contents.versions_[4]->isEmpty());
+
+    // Versions read back share nodes as the originals did.
+    ASSERT_EQ(contents.versions_[0],
+              contents.versions_[2]->asBranch()->right());
+}
+
+TEST(CheckpointTest, resume) {
+    using Tree = Tree<int, int>;
+    std::stringstream log;
+    auto              t = Tree::from_range({1, 2, 3, 4});
+    {
+        NodeLog<Tree> writer(log);
+        writer.checkpoint(t);
+        writer.checkpoint(append(5, t));
+    }
+
+    auto          contents = read_node_log<Tree>(log);
+    auto          last     = contents.versions_.back();
+    std::stringstream more(log.str(), std::ios::in | std::ios::out |
+                                          std::ios::ate);
+    NodeLog<Tree> writer(more, contents);
+    ASSERT_EQ(0u, writer.checkpoint(last));
+    ASSERT_EQ(2u, writer.checkpoint(Tree::branch(Tree::leaf(0), last)));
+
+    auto again = read_node_log<Tree>(more);
+    ASSERT_EQ(4u, again.versions_.size());
+    ASSERT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5}),
+              flatten(again.versions_.back()));
+}
+
+TEST(CheckpointTest, ignoresTruncatedCheckpoint) {
+    using Tree = Tree<int, int>;
+    std::stringstream log;
+    NodeLog<Tree>     writer(log);
+    writer.checkpoint(Tree::from_range({1, 2, 3}));
+    auto complete = log.str().size();
+    writer.checkpoint(Tree::from_range({4, 5, 6}));
+
+    for (auto cut = complete; cut < log.str().size(); cut += 7) {
+        std::stringstream partial(log.str().substr(0, cut));
+        auto              contents = read_node_log<Tree>(partial);
+        ASSERT_EQ(1u, contents.versions_.size());
+        ASSERT_EQ((std::vector<int>{1, 2, 3}),
+                  flatten(contents.versions_.back()));
+    }
+
+    std::stringstream garbage("not a log");
+    ASSERT_THROW(read_node_log<Tree>(garbage), std::runtime_error);
+    using Other = fringetree::Tree<int, double>;
+    std::stringstream wrong(log.str());
+    ASSERT_THROW(read_node_log<Other>(wrong), std::runtime_error);
+}
+
+// A log cut short by a crash is carried on from its last complete
+// checkpoint, whether what was cut off is longer or shorter than what
+// follows.
+TEST(CheckpointTest, resumeAfterTruncation) {
+    using Tree = Tree<int, int>;
+    std::stringstream log;
+    NodeLog<Tree>     writer(log);
+    auto              first = Tree::from_range({1, 2, 3});
+    writer.checkpoint(first);
+    auto complete = log.str().size();
+    writer.checkpoint(Tree::from_range({4, 5, 6, 7, 8, 9}));
+
+    for (auto cut = complete; cut < log.str().size(); cut += 5) {
+        std::stringstream partial(log.str().substr(0, cut));
+        auto              contents = read_node_log<Tree>(partial);
+        ASSERT_EQ(complete, contents.end_);
+
+        std::stringstream torn(partial.str(), std::ios::in | std::ios::out);
+
+        NodeLog<Tree> resumed(torn, contents);
+        auto          small = append(4, contents.versions_.back());
+        resumed.checkpoint(small);
+        resumed.checkpoint(append(5, small));
+
+        auto again = read_node_log<Tree>(torn);
+        ASSERT_EQ(3u, again.versions_.size());
+        ASSERT_EQ(first->size(), again.versions_[0]->size());
+        ASSERT_EQ((std::vector<int>{1, 2, 3, 4, 5}),
+                  flatten(again.versions_.back()));
+        ASSERT_EQ(torn.str().size(), again.end_);
+    }
+}
+
+// A checkpoint the stream failed to take is forgotten, so it is written in
+// full once the stream works again.
+TEST(CheckpointTest, failedWrite) {
+    using Tree = Tree<int, int>;
+    std::stringstream log;
+    NodeLog<Tree>     writer(log);
+    auto              t = Tree::from_range({1, 2, 3});
+    writer.checkpoint(t);
+    auto nodes = writer.nodes();
+
+    auto              more = append(4, t);
+    std::stringstream reference;
+    NodeLog<Tree>     expected(reference);
+    expected.checkpoint(t);
+    auto fresh = expected.checkpoint(more);
+
+    log.setstate(std::ios::badbit);
+    ASSERT_THROW(writer.checkpoint(more), std::runtime_error);
+    ASSERT_EQ(nodes, writer.nodes());
+
+    log.clear();
+    ASSERT_EQ(fresh, writer.checkpoint(more));
+    auto contents = read_node_log<Tree>(log);
+    ASSERT_EQ(2u, contents.versions_.size());
+    ASSERT_EQ((std::vector<int>{1, 2, 3, 4}),
+              flatten(contents.versions_.back()));
+}
+
+TEST(CheckpointTest, trim) {
+    using Tree = Tree<int, int>;
+    std::stringstream log;
+    NodeLog<Tree>     writer(log);
+
+    auto v    = values(100);
+    auto keep = Tree::from_range(v.begin(), v.begin() + 50);
+    writer.checkpoint(keep);
+    {
+        auto drop = Tree::from_range(v.begin(), v.end());
+        writer.checkpoint(drop);
+    }
+    ASSERT_EQ(99u + 199u, writer.nodes());
+    writer.trim();
+    ASSERT_EQ(99u, writer.nodes());
+    ASSERT_EQ(0u, writer.checkpoint(keep));
+
+    auto contents = read_node_log<Tree>(log);
+    ASSERT_EQ(v, flatten(contents.versions_[1]));
+}
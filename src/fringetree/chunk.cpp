@@ -0,0 +1,2 @@
+// chunk.cpp                                                          -*-C++-*-
+#include <fringetree/chunk.h>
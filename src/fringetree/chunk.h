@@ -0,0 +1,348 @@
+// chunk.h                                                            -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_CHUNK
+#define INCLUDED_FRINGETREE_CHUNK
+
+#include <fringetree/fringetree.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace fringetree {
+
+// Up to 'N' values stored inline, used as the value of a leaf so that a tree
+// keeps its values in short runs of contiguous memory rather than one to a
+// node.  A chunk is never changed once it is in a tree: adding a value makes
+// a new chunk.  'Value' must be default constructible.
+template <typename Value, std::size_t N>
+class Chunk {
+    static_assert(N > 0);
+
+    std::array<Value, N> values_;
+    std::size_t          size_ = 0;
+
+  public:
+    using value_type     = Value;
+    using const_iterator = Value const*;
+
+    static constexpr std::size_t capacity = N;
+
+    Chunk() = default;
+
+    // Takes at most 'N' values from '[first, last)'.
+    template <typename Iterator>
+    Chunk(Iterator first, Iterator last) {
+        for (; first != last && size_ < N; ++first) {
+            values_[size_++] = *first;
+        }
+    }
+
+    explicit Chunk(Value v) : size_(1) { values_[0] = std::move(v); }
+
+    auto size() const -> std::size_t { return size_; }
+    bool full() const { return size_ == N; }
+
+    auto begin() const -> const_iterator { return values_.data(); }
+    auto end() const -> const_iterator { return values_.data() + size_; }
+
+    auto operator[](std::size_t i) const -> Value const& {
+        return values_[i];
+    }
+
+    auto front() const -> Value const& { return values_[0]; }
+    auto back() const -> Value const& { return values_[size_ - 1]; }
+
+    auto push_back(Value v) const -> Chunk {
+        Chunk c(*this);
+        c.values_[c.size_++] = std::move(v);
+        return c;
+    }
+
+    auto push_front(Value v) const -> Chunk {
+        Chunk c;
+        c.values_[0] = std::move(v);
+        std::copy(begin(), end(), c.values_.begin() + 1);
+        c.size_ = size_ + 1;
+        return c;
+    }
+
+    friend bool operator==(Chunk const& lhs, Chunk const& rhs) {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+
+    friend bool operator!=(Chunk const& lhs, Chunk const& rhs) {
+        return !(lhs == rhs);
+    }
+};
+
+// Counts values rather than leaves, so that the tag of any subtree of a
+// chunked tree is the number of values in it.
+template <typename Tag>
+struct ChunkMeasure {
+    static auto identity() -> Tag { return Tag{0}; }
+
+    template <typename Chunk>
+    static auto leaf(Chunk const& c) -> Tag {
+        return Tag(c.size());
+    }
+
+    static auto combine(Tag const& left, Tag const& right) -> Tag {
+        return left + right;
+    }
+};
+
+// By default a chunk holds about 256 bytes of values, which keeps the cost
+// of moving to the next leaf small next to scanning the chunk, while copying
+// a chunk on every update at an end stays cheap.
+template <typename Value>
+constexpr std::size_t chunk_capacity =
+    sizeof(Value) < 256 ? 256 / sizeof(Value) : 1;
+
+// A tree of chunks is an ordinary 'Tree', so every operation on trees works
+// on it a chunk at a time.  The operations below work on it a value at a
+// time.
+template <typename Value,
+          std::size_t N      = chunk_capacity<Value>,
+          typename Allocator = std::allocator<Chunk<Value, N>>,
+          typename Ownership = SharedOwnership>
+using ChunkedTree = Tree<std::size_t,
+                         Chunk<Value, N>,
+                         ChunkMeasure<std::size_t>,
+                         Allocator,
+                         Ownership>;
+
+// Builds a balanced tree of full chunks, the last one excepted.
+template <typename Tree, typename Iterator>
+auto chunk_from_range(Iterator first, Iterator last) -> typename Tree::Ptr_ {
+    using Chunk_ = typename Tree::Value_;
+    std::vector<typename Chunk_::value_type> values(first, last);
+    std::vector<Chunk_>                      chunks;
+    chunks.reserve((values.size() + Chunk_::capacity - 1) /
+                   Chunk_::capacity);
+    for (auto it = values.begin(); it != values.end();) {
+        auto n = std::min<std::size_t>(Chunk_::capacity, values.end() - it);
+        chunks.emplace_back(it, it + n);
+        it += n;
+    }
+    return Tree::from_range(std::make_move_iterator(chunks.begin()),
+                            std::make_move_iterator(chunks.end()));
+}
+
+// The number of values in a chunked tree.
+constexpr auto chunk_size = [](auto const& tree) { return tree->tag(); };
+
+// Adds a value at one end, into the end chunk while it has room.  Filling a
+// chunk rebuilds the path to it without changing any leaf counts, so no
+// rotations are needed; a full end chunk gets a new chunk beside it.
+constexpr inline struct chunk_append {
+    template <typename V, typename TreePtr>
+    auto operator()(V v, TreePtr const& tree) const -> TreePtr {
+        using Tree_ = typename TreePtr::element_type;
+        using Chunk = typename Tree_::Value_;
+        PathStack<typename Tree_::Branch_ const*> path;
+        auto const*                               node = &tree;
+        while (auto const* b = (*node)->asBranch()) {
+            path.push(b);
+            node = &b->right();
+        }
+        auto const* l = (*node)->asLeaf();
+        if (l == nullptr || l->value().full()) {
+            return append(Chunk(std::move(v)), tree);
+        }
+        auto result = Tree_::leaf(l->value().push_back(std::move(v)));
+        while (!path.empty()) {
+            result = Tree_::branch(path.pop()->left(), result);
+        }
+        return result;
+    }
+} chunk_append_;
+
+constexpr auto chunk_append = [](auto v, auto tree) {
+    return chunk_append_(std::move(v), tree);
+};
+
+constexpr inline struct chunk_prepend {
+    template <typename V, typename TreePtr>
+    auto operator()(V v, TreePtr const& tree) const -> TreePtr {
+        using Tree_ = typename TreePtr::element_type;
+        using Chunk = typename Tree_::Value_;
+        PathStack<typename Tree_::Branch_ const*> path;
+        auto const*                               node = &tree;
+        while (auto const* b = (*node)->asBranch()) {
+            path.push(b);
+            node = &b->left();
+        }
+        auto const* l = (*node)->asLeaf();
+        if (l == nullptr || l->value().full()) {
+            return prepend(Chunk(std::move(v)), tree);
+        }
+        auto result = Tree_::leaf(l->value().push_front(std::move(v)));
+        while (!path.empty()) {
+            result = Tree_::branch(result, path.pop()->right());
+        }
+        return result;
+    }
+} chunk_prepend_;
+
+constexpr auto chunk_prepend = [](auto v, auto tree) {
+    return chunk_prepend_(std::move(v), tree);
+};
+
+// Finds the 'i'th value by the value counts in the tags, then indexes into
+// its chunk.
+constexpr inline struct chunk_index {
+    template <typename TreePtr>
+    auto operator()(TreePtr const& tree, std::size_t i) const ->
+        typename TreePtr::element_type::Value_::value_type const& {
+        if (!(i < tree->tag())) {
+            throw std::out_of_range("fringetree::chunk_index");
+        }
+        auto const* node = tree.get();
+        while (auto const* b = node->asBranch()) {
+            auto leftSize = std::size_t(b->left()->tag());
+            if (i < leftSize) {
+                node = b->left().get();
+            } else {
+                i -= leftSize;
+                node = b->right().get();
+            }
+        }
+        return node->asLeaf()->value()[i];
+    }
+} chunk_index_;
+
+constexpr auto chunk_index = [](auto const& tree, auto i) -> decltype(auto) {
+    return chunk_index_(tree, i);
+};
+
+// Forward iterator over the values of a chunked tree, stepping through each
+// chunk's array before moving to the next leaf.
+template <typename Tree>
+class ChunkIterator {
+    using Chunk_ = typename Tree::Value_;
+
+    LeafIterator<Tree>              leaf_;
+    typename Chunk_::const_iterator value_;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = typename Chunk_::value_type;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = value_type const*;
+    using reference         = value_type const&;
+
+    ChunkIterator() : leaf_(), value_(nullptr) {}
+
+    ChunkIterator(Tree const* root, bool atEnd)
+        : leaf_(root, atEnd),
+          value_(atEnd || root->isEmpty() ? nullptr : leaf_->begin()) {}
+
+    auto operator*() const -> reference { return *value_; }
+    auto operator->() const -> pointer { return value_; }
+
+    auto operator++() -> ChunkIterator& {
+        if (++value_ == leaf_->end()) {
+            ++leaf_;
+            value_ = nullptr;
+            LeafIterator<Tree> end;
+            if (!(leaf_ == end)) {
+                value_ = leaf_->begin();
+            }
+        }
+        return *this;
+    }
+
+    auto operator++(int) -> ChunkIterator {
+        auto tmp = *this;
+        ++*this;
+        return tmp;
+    }
+
+    friend bool operator==(ChunkIterator const& lhs,
+                           ChunkIterator const& rhs) {
+        return lhs.value_ == rhs.value_;
+    }
+
+    friend bool operator!=(ChunkIterator const& lhs,
+                           ChunkIterator const& rhs) {
+        return !(lhs == rhs);
+    }
+};
+
+// The values of a chunked tree as a range, for range-for and algorithms.
+template <typename Tree>
+class ChunkRange {
+    typename Tree::Ptr_ tree_;
+
+  public:
+    explicit ChunkRange(typename Tree::Ptr_ tree) : tree_(std::move(tree)) {}
+
+    auto begin() const -> ChunkIterator<Tree> {
+        return ChunkIterator<Tree>(tree_.get(), false);
+    }
+
+    auto end() const -> ChunkIterator<Tree> {
+        return ChunkIterator<Tree>(tree_.get(), true);
+    }
+};
+
+constexpr auto chunk_values = [](auto tree) {
+    return ChunkRange<typename decltype(tree)::element_type>(tree);
+};
+
+// Copies whole chunks at a time into one vector.
+constexpr auto chunk_flatten = [](auto const& tree) {
+    using Chunk_ = typename std::decay_t<decltype(*tree)>::Value_;
+    std::vector<typename Chunk_::value_type> v;
+    v.reserve(tree->tag());
+    for (auto const& c : *tree) {
+        v.insert(v.end(), c.begin(), c.end());
+    }
+    return v;
+};
+
+// Compares the values of two chunked trees, which may be chunked
+// differently.  A run of equal values is compared a chunk against a chunk
+// at a time, with 'std::equal' over the overlapping part.
+constexpr auto chunk_same_fringe = [](auto const& a, auto const& b) {
+    if (a == b) {
+        return true;
+    }
+    if (a->tag() != b->tag()) {
+        return false;
+    }
+    auto ia = a->begin();
+    auto ib = b->begin();
+    auto ea = a->end();
+    if (ia == ea) {
+        return true;
+    }
+    auto pa = ia->begin();
+    auto pb = ib->begin();
+    while (true) {
+        auto n = std::min(ia->end() - pa, ib->end() - pb);
+        if (!std::equal(pa, pa + n, pb)) {
+            return false;
+        }
+        pa += n;
+        pb += n;
+        if (pa == ia->end()) {
+            if (++ia == ea) {
+                return true;
+            }
+            pa = ia->begin();
+        }
+        if (pb == ib->end()) {
+            ++ib;
+            pb = ib->begin();
+        }
+    }
+};
+
+} // namespace fringetree
+
+#endif
@@ -0,0 +1,96 @@
+#include <fringetree/chunk.h>
+#include <fringetree/testsupport.t.h>
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+using namespace fringetree;
+using namespace fringetree::test;
+
+TEST(ChunkTest, chunk) {
+    using C = Chunk<int, 4>;
+    auto v  = values(10);
+    C    c(v.begin(), v.end());
+    ASSERT_EQ(4u, c.size());
+    ASSERT_TRUE(c.full());
+    ASSERT_EQ(3, c.back());
+
+    C    d(2);
+    auto e = d.push_back(3).push_front(1);
+    ASSERT_EQ((std::vector<int>{1, 2, 3}),
+              std::vector<int>(e.begin(), e.end()));
+    ASSERT_EQ(1u, d.size());
+    ASSERT_EQ(C(v.begin() + 1, v.begin() + 4), e);
+}
+
+TEST(ChunkTest, fromRange) {
+    using Tree = ChunkedTree<int, 8>;
+    auto v     = values(1001);
+    auto t     = chunk_from_range<Tree>(v.begin(), v.end());
+    ASSERT_EQ(1001u, chunk_size(t));
+    ASSERT_EQ(126u, t->size());
+    ASSERT_EQ(v, chunk_flatten(t));
+    for (std::size_t i = 0; i < v.size(); i += 13) {
+        ASSERT_EQ(v[i], chunk_index(t, i));
+    }
+    ASSERT_THROW(chunk_index(t, 1001), std::out_of_range);
+
+    std::vector<int> seen;
+    for (auto i : chunk_values(t)) {
+        seen.push_back(i);
+    }
+    ASSERT_EQ(v, seen);
+
+    auto empty = chunk_from_range<Tree>(v.begin(), v.begin());
+    ASSERT_TRUE(empty->isEmpty());
+    ASSERT_TRUE(chunk_flatten(empty).empty());
+    ASSERT_EQ(chunk_values(empty).begin(), chunk_values(empty).end());
+}
+
+TEST(ChunkTest, appendPrepend) {
+    using Tree = ChunkedTree<int, 4>;
+    auto             t = Tree::empty();
+    std::vector<int> expected;
+    for (int i = 0; i < 300; ++i) {
+        if (i % 5 == 0) {
+            t = chunk_prepend(i, t);
+            expected.insert(expected.begin(), i);
+        } else {
+            t = chunk_append(i, t);
+            expected.push_back(i);
+        }
+    }
+    ASSERT_EQ(expected, chunk_flatten(t));
+    ASSERT_EQ(300u, chunk_size(t));
+    // Appends fill the end chunks, so leaves stay close to full.
+    ASSERT_LT(t->size(), 300u / 4 + 300u / 5);
+
+    // The chunk-level view API still applies.
+    auto view = view_l(t);
+    ASSERT_EQ(expected[0], view.value().front());
+    ASSERT_EQ(300u - view.value().size(), chunk_size(view.tree()));
+    ASSERT_EQ(300u, measure(t));
+}
+
+TEST(ChunkTest, sameFringe) {
+    using Tree = ChunkedTree<int, 4>;
+    auto v     = values(100);
+    auto a     = chunk_from_range<Tree>(v.begin(), v.end());
+    auto b     = Tree::empty();
+    for (int i = 100; i-- > 0;) {
+        b = chunk_prepend(i, b);
+    }
+    ASSERT_NE(a->size(), b->size() + 1);
+    ASSERT_TRUE(chunk_same_fringe(a, b));
+    ASSERT_TRUE(chunk_same_fringe(b, a));
+    ASSERT_TRUE(chunk_same_fringe(a, a));
+
+    auto c = chunk_append(100, a);
+    ASSERT_FALSE(chunk_same_fringe(a, c));
+    v[57]  = -1;
+    auto d = chunk_from_range<Tree>(v.begin(), v.end());
+    ASSERT_FALSE(chunk_same_fringe(b, d));
+    ASSERT_TRUE(chunk_same_fringe(Tree::empty(), Tree::empty()));
+}
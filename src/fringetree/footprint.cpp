@@ -0,0 +1,2 @@
+// footprint.cpp                                                      -*-C++-*-
+#include <fringetree/footprint.h>
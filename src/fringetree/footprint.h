@@ -0,0 +1,239 @@
+// footprint.h                                                        -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_FOOTPRINT
+#define INCLUDED_FRINGETREE_FOOTPRINT
+
+#include <fringetree/fringetree.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fringetree {
+
+// An allocator that adds up what it is asked for, used to learn the size of
+// the single block 'std::allocate_shared' allocates for a node and its
+// control block.
+template <typename T>
+class SizeProbe {
+  public:
+    using value_type = T;
+
+    std::size_t* bytes_;
+
+    explicit SizeProbe(std::size_t* bytes) : bytes_(bytes) {}
+
+    template <typename U>
+    SizeProbe(SizeProbe<U> const& other) : bytes_(other.bytes_) {}
+
+    auto allocate(std::size_t n) -> T* {
+        *bytes_ += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n) {
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template <typename U>
+    friend bool operator==(SizeProbe const& lhs, SizeProbe<U> const& rhs) {
+        return lhs.bytes_ == rhs.bytes_;
+    }
+
+    template <typename U>
+    friend bool operator!=(SizeProbe const& lhs, SizeProbe<U> const& rhs) {
+        return !(lhs == rhs);
+    }
+};
+
+// The bytes one node of 'Tree' takes, counting its reference counts.  Shared
+// nodes carry them in a control block allocated with the node; intrusive
+// nodes carry them inside the node.  Allocator rounding, and memory that a
+// value owns elsewhere, are not counted.
+template <typename Tree>
+auto node_bytes() -> std::size_t {
+    if constexpr (std::is_same_v<typename Tree::Ownership_, SharedOwnership>) {
+        static std::size_t const bytes = [] {
+            std::size_t n = 0;
+            std::allocate_shared<Tree>(SizeProbe<Tree>(&n),
+                                       typename Tree::Empty_{});
+            return n;
+        }();
+        return bytes;
+    } else {
+        return sizeof(Tree);
+    }
+}
+
+// What one of the roots given to 'footprint' reaches.  A node is unique to
+// the root if no other root reaches it, and shared otherwise.
+struct VersionFootprint {
+    std::size_t nodes_       = 0;
+    std::size_t bytes_       = 0;
+    std::size_t unique_      = 0;
+    std::size_t uniqueBytes_ = 0;
+    std::size_t depth_       = 0;
+
+    auto shared() const -> std::size_t { return nodes_ - unique_; }
+    auto sharedBytes() const -> std::size_t { return bytes_ - uniqueBytes_; }
+};
+
+// The memory taken by a set of trees, every node counted once however many
+// of them reach it.  A node's depth differs between the trees sharing it but
+// its height does not, so 'heights_[h]' counts the nodes of height 'h',
+// leaves being of height 1.  'balance_' is the largest ratio of the larger
+// to the smaller child's size over all branches, at most 'balance::delta'
+// in a tree built only by the balancing operations.  Suspensions are not
+// forced: one that has been is followed into its result, and one that has
+// not into the inputs it holds.
+struct Footprint {
+    std::size_t                   empties_     = 0;
+    std::size_t                   leaves_      = 0;
+    std::size_t                   branches_    = 0;
+    std::size_t                   suspensions_ = 0;
+    std::size_t                   nodes_       = 0;
+    std::size_t                   bytes_       = 0;
+    std::vector<VersionFootprint> versions_;
+    std::vector<std::size_t>      heights_;
+    double                        balance_ = 1.0;
+};
+
+// Walks the nodes reachable from 'roots' once, depth first, numbering them
+// children before parents.  Then which roots reach each node is worked out
+// as a bit set per node, passed from each node to its children in the
+// reverse order.  That takes O(nodes * roots / 64) words and time on top of
+// the walk.
+constexpr inline struct footprint {
+    template <typename TreePtr>
+    auto operator()(std::vector<TreePtr> const& roots) const -> Footprint {
+        using Tree_ = typename TreePtr::element_type;
+        auto const bytes = node_bytes<Tree_>();
+
+        using Held = typename Tree_::Suspension_::Inputs_;
+        std::unordered_map<Tree_ const*, std::size_t> number;
+        std::unordered_map<Tree_ const*, Held>        held;
+        std::vector<Tree_ const*>                     nodes;
+        std::vector<std::pair<Tree_ const*, bool>>    stack;
+        for (auto const& root : roots) {
+            stack.push_back({root.get(), false});
+            while (!stack.empty()) {
+                auto [node, done] = stack.back();
+                stack.pop_back();
+                if (done) {
+                    number[node] = nodes.size();
+                    nodes.push_back(node);
+                    continue;
+                }
+                if (!number.emplace(node, 0).second) {
+                    continue;
+                }
+                stack.push_back({node, true});
+                if (node->isSuspended()) {
+                    auto const& in = held[node] = node->held();
+                    for (auto it = in.rbegin(); it != in.rend(); ++it) {
+                        if (*it) {
+                            stack.push_back({it->get(), false});
+                        }
+                    }
+                } else if (auto const* b = node->asBranch()) {
+                    stack.push_back({b->right().get(), false});
+                    stack.push_back({b->left().get(), false});
+                }
+            }
+        }
+
+        Footprint result;
+        result.nodes_ = nodes.size();
+        result.bytes_ = nodes.size() * bytes;
+        std::vector<std::size_t> height(nodes.size());
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            auto const* node = nodes[i];
+            if (node->isEmpty()) {
+                ++result.empties_;
+                height[i] = 0;
+            } else if (node->isSuspended()) {
+                ++result.suspensions_;
+                height[i] = 1;
+                for (auto const& in : held[node]) {
+                    if (in) {
+                        height[i] = std::max(height[i],
+                                             1 + height[number[in.get()]]);
+                    }
+                }
+            } else if (auto const* b = node->asBranch()) {
+                ++result.branches_;
+                height[i] = 1 + std::max(height[number[b->left().get()]],
+                                         height[number[b->right().get()]]);
+                auto l = double(b->left()->size());
+                auto r = double(b->right()->size());
+                result.balance_ =
+                    std::max(result.balance_, std::max(l / r, r / l));
+            } else {
+                ++result.leaves_;
+                height[i] = 1;
+            }
+            if (result.heights_.size() <= height[i]) {
+                result.heights_.resize(height[i] + 1);
+            }
+            ++result.heights_[height[i]];
+        }
+
+        auto const words = (roots.size() + 63) / 64;
+        std::vector<std::uint64_t> reach(nodes.size() * words);
+        result.versions_.resize(roots.size());
+        for (std::size_t v = 0; v < roots.size(); ++v) {
+            auto i = number[roots[v].get()];
+            reach[i * words + v / 64] |= std::uint64_t(1) << (v % 64);
+            result.versions_[v].depth_ = height[i];
+        }
+        for (auto i = nodes.size(); i-- != 0;) {
+            auto const* own = &reach[i * words];
+            std::array<Tree_ const*, 2> children{};
+            if (nodes[i]->isSuspended()) {
+                auto const& in = held[nodes[i]];
+                children       = {in[0].get(), in[1].get()};
+            } else if (auto const* b = nodes[i]->asBranch()) {
+                children = {b->left().get(), b->right().get()};
+            }
+            for (auto const* child : children) {
+                if (child == nullptr) {
+                    continue;
+                }
+                auto* c = &reach[number[child] * words];
+                for (std::size_t w = 0; w < words; ++w) {
+                    c[w] |= own[w];
+                }
+            }
+            std::size_t reached = 0;
+            std::size_t last    = 0;
+            for (std::size_t v = 0; v < roots.size(); ++v) {
+                if (own[v / 64] == 0) {
+                    v |= 63; // on to the next word
+                } else if (own[v / 64] >> (v % 64) & 1) {
+                    ++reached;
+                    last = v;
+                    ++result.versions_[v].nodes_;
+                    result.versions_[v].bytes_ += bytes;
+                }
+            }
+            if (reached == 1) {
+                ++result.versions_[last].unique_;
+                result.versions_[last].uniqueBytes_ += bytes;
+            }
+        }
+        return result;
+    }
+} footprint_;
+
+constexpr auto footprint = [](auto const& root, auto const&... roots) {
+    return footprint_(std::vector{root, roots...});
+};
+
+} // namespace fringetree
+
+#endif
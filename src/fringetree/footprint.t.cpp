@@ -0,0 +1,164 @@
+#include <fringetree/footprint.h>
+#include <fringetree/intrusive.h>
+#include <fringetree/lazy.h>
+#include <fringetree/testsupport.t.h>
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+
+using namespace fringetree;
+using namespace fringetree::test;
+
+namespace {
+template <typename TreePtr>
+void reachable(TreePtr const& tree, std::set<void const*>& seen) {
+    if (!seen.insert(tree.get()).second) {
+        return;
+    }
+    if (auto const* b = tree->asBranch()) {
+        reachable(b->left(), seen);
+        reachable(b->right(), seen);
+    }
+}
+} // namespace
+
+TEST(FootprintTest, single) {
+    using Tree = Tree<int, int>;
+    auto v     = values(8);
+    auto t     = Tree::from_range(v.begin(), v.end());
+
+    auto f = footprint(t);
+    ASSERT_EQ(0u, f.empties_);
+    ASSERT_EQ(8u, f.leaves_);
+    ASSERT_EQ(7u, f.branches_);
+    ASSERT_EQ(15u, f.nodes_);
+    ASSERT_GT(node_bytes<Tree>(), sizeof(Tree));
+    ASSERT_EQ(15 * node_bytes<Tree>(), f.bytes_);
+    ASSERT_EQ((std::vector<std::size_t>{0, 8, 4, 2, 1}), f.heights_);
+    ASSERT_EQ(1.0, f.balance_);
+
+    ASSERT_EQ(1u, f.versions_.size());
+    ASSERT_EQ(15u, f.versions_[0].nodes_);
+    ASSERT_EQ(15u, f.versions_[0].unique_);
+    ASSERT_EQ(0u, f.versions_[0].shared());
+    ASSERT_EQ(4u, f.versions_[0].depth_);
+
+    auto e = footprint(Tree::empty());
+    ASSERT_EQ(1u, e.empties_);
+    ASSERT_EQ(0u, e.versions_[0].depth_);
+
+    auto lopsided = Tree::branch(Tree::leaf(0), t);
+    ASSERT_EQ(8.0, footprint(lopsided).balance_);
+}
+
+TEST(FootprintTest, versions) {
+    using Tree = Tree<int, int>;
+    auto v     = values(100);
+    auto a     = Tree::from_range(v.begin(), v.end());
+    auto b     = append(100, a);
+    auto c     = prepend(-1, b);
+    auto d     = concat(a, a);
+
+    std::vector<Tree::Ptr_> roots{a, b, c, d};
+    auto                    f = footprint_(roots);
+
+    std::vector<std::set<void const*>> seen(roots.size());
+    std::set<void const*>              all;
+    for (std::size_t i = 0; i < roots.size(); ++i) {
+        reachable(roots[i], seen[i]);
+        all.insert(seen[i].begin(), seen[i].end());
+    }
+    ASSERT_EQ(all.size(), f.nodes_);
+    ASSERT_EQ(f.nodes_, f.leaves_ + f.branches_);
+    ASSERT_EQ(101u + 1u, f.leaves_);
+
+    for (std::size_t i = 0; i < roots.size(); ++i) {
+        std::size_t unique = 0;
+        for (auto const* node : seen[i]) {
+            std::size_t owners = 0;
+            for (auto const& s : seen) {
+                owners += s.count(node);
+            }
+            unique += owners == 1;
+        }
+        ASSERT_EQ(seen[i].size(), f.versions_[i].nodes_);
+        ASSERT_EQ(unique, f.versions_[i].unique_);
+        ASSERT_EQ(unique * node_bytes<Tree>(), f.versions_[i].uniqueBytes_);
+        ASSERT_EQ(depth(roots[i]), f.versions_[i].depth_);
+    }
+
+    // Versions made by the persistent operations share almost everything.
+    ASSERT_LT(f.versions_[1].unique_, 10u);
+    ASSERT_LE(f.balance_, double(balance::delta));
+
+    // Passing the same root twice makes all of it shared.
+    auto twice = footprint(a, a);
+    ASSERT_EQ(0u, twice.versions_[0].unique_);
+    ASSERT_EQ(twice.nodes_, twice.versions_[1].shared());
+}
+
+TEST(FootprintTest, manyVersions) {
+    using Tree = Tree<int, int>;
+    std::vector<Tree::Ptr_> roots{Tree::empty()};
+    for (int i = 0; i < 150; ++i) {
+        roots.push_back(append(i, roots.back()));
+    }
+    auto f = footprint_(roots);
+    ASSERT_EQ(151u, f.versions_.size());
+    ASSERT_EQ(150u, f.leaves_);
+    for (std::size_t i = 0; i < roots.size(); ++i) {
+        std::set<void const*> seen;
+        reachable(roots[i], seen);
+        ASSERT_EQ(seen.size(), f.versions_[i].nodes_);
+    }
+    ASSERT_EQ(f.versions_.back().nodes_, f.versions_.back().shared() +
+                                             f.versions_.back().unique_);
+}
+
+TEST(FootprintTest, suspensionsAreNotForced) {
+    using Tree = Tree<int, int>;
+    auto v     = values(10);
+    auto t     = Tree::from_range(v.begin(), v.end());
+    int  calls = 0;
+    auto m     = lazy_map(t, [&calls](int i) {
+        ++calls;
+        return i;
+    });
+    auto f = footprint(m, t);
+    ASSERT_EQ(1u, f.suspensions_);
+    ASSERT_EQ(10u, f.leaves_);
+    ASSERT_EQ(20u, f.versions_[0].nodes_);
+    ASSERT_EQ(1u, f.versions_[0].unique_);
+    ASSERT_EQ(0, calls);
+
+    // Once forced, a suspension is followed into its result.
+    ASSERT_EQ(v, flatten(m));
+    ASSERT_EQ(10, calls);
+    f = footprint(m, t);
+    ASSERT_EQ(10, calls);
+    ASSERT_EQ(20u, f.leaves_);
+    ASSERT_EQ(19u, f.suspensions_);
+    ASSERT_EQ(18u, f.branches_);
+    ASSERT_EQ(19u + 9 + 10, f.versions_[0].unique_);
+    ASSERT_EQ(0u, f.versions_[0].shared());
+    ASSERT_EQ(19u, f.versions_[1].nodes_);
+
+    auto s = lazy_slice(t, 2, 8);
+    f      = footprint(s);
+    ASSERT_TRUE(s->isPending());
+    ASSERT_EQ(1u, f.suspensions_);
+    ASSERT_EQ(10u, f.leaves_);
+}
+
+TEST(FootprintTest, intrusiveOwnership) {
+    using Tree =
+        Tree<int, int, SizeMeasure<int>, std::allocator<int>, LocalOwnership>;
+    auto v = values(10);
+    auto t = Tree::from_range(v.begin(), v.end());
+    auto f = footprint(t, append(10, t));
+    ASSERT_EQ(sizeof(Tree), node_bytes<Tree>());
+    ASSERT_EQ(f.nodes_ * sizeof(Tree), f.bytes_);
+    ASSERT_EQ(11u, f.leaves_);
+}
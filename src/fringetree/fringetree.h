@@ -2,197 +2,997 @@
 #ifndef INCLUDED_FRINGETREE
 #define INCLUDED_FRINGETREE
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#endif
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
 
 namespace fringetree {
 
-template <typename Tag, typename Value>
+// A measure supplies the monoid cached in every node's tag: 'identity' is the
+// tag of an empty tree, 'leaf' the tag of a single value, and 'combine' the
+// associative operation folding the tags of a branch's children.  The default
+// counts leaves.
+template <typename Tag>
+struct SizeMeasure {
+    static auto identity() -> Tag { return Tag{0}; }
+
+    template <typename Value>
+    static auto leaf(Value const&) -> Tag {
+        return Tag{1};
+    }
+
+    static auto combine(Tag const& left, Tag const& right) -> Tag {
+        return left + right;
+    }
+};
+
+// An ownership policy decides how nodes are referenced and freed.  It
+// supplies the pointer type 'Ptr<Node>', a 'Hook<Node, Allocator>' base that
+// carries any per-node bookkeeping, 'make', which allocates and builds a
+// node, and 'make_static', which builds a node that must live until exit
+// without going through the tree's allocator.  'SharedOwnership' uses
+// 'std::shared_ptr' and needs no hook.
+struct SharedOwnership {
+    template <typename Node>
+    using Ptr = std::shared_ptr<Node>;
+
+    template <typename Node, typename Allocator>
+    class Hook {};
+
+    template <typename Node, typename Allocator, typename... Args>
+    static auto make(Allocator const& alloc, Args&&... args) -> Ptr<Node> {
+        return std::allocate_shared<Node>(alloc, std::forward<Args>(args)...);
+    }
+
+    template <typename Node, typename... Args>
+    static auto make_static(Args&&... args) -> Ptr<Node> {
+        return std::make_shared<Node>(std::forward<Args>(args)...);
+    }
+};
+
+// Whether 'p' holds the only reference to its node, so that the node may be
+// rewritten or taken apart.  Counts may be read with a relaxed load, as
+// 'std::shared_ptr::use_count' is, so the fence orders what follows after
+// every other owner's release of its reference.
+template <typename Ptr>
+bool sole_owner(Ptr const& p) {
+    if (p.use_count() != 1) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+template <typename Tag,
+          typename Value,
+          typename Measure   = SizeMeasure<Tag>,
+          typename Allocator = std::allocator<Value>,
+          typename Ownership = SharedOwnership>
 class Branch;
 
-template <typename Tag, typename Value>
+template <typename Tag,
+          typename Value,
+          typename Measure   = SizeMeasure<Tag>,
+          typename Allocator = std::allocator<Value>,
+          typename Ownership = SharedOwnership>
 class Leaf;
 
-template <typename Tag, typename Value>
+template <typename Tag,
+          typename Value,
+          typename Measure   = SizeMeasure<Tag>,
+          typename Allocator = std::allocator<Value>,
+          typename Ownership = SharedOwnership>
 class Empty;
 
-template <typename Tag, typename Value>
+template <typename Tag,
+          typename Value,
+          typename Measure   = SizeMeasure<Tag>,
+          typename Allocator = std::allocator<Value>,
+          typename Ownership = SharedOwnership>
+class Suspension;
+
+// Nodes are allocated through 'Allocator', rebound by the ownership policy to
+// the node type it actually allocates.  The allocator is default constructed
+// for every node, so it should be stateless or, like 'ResourceAllocator',
+// pick up its state from the allocating thread.
+template <typename Tag,
+          typename Value,
+          typename Measure   = SizeMeasure<Tag>,
+          typename Allocator = std::allocator<Value>,
+          typename Ownership = SharedOwnership>
 class Tree;
 
-template <typename Tag, typename Value>
+template <typename Tree>
+using Ptr = typename Tree::Ptr_;
+
+template <typename Tree>
+class LeafIterator;
+
+template <typename Tree>
+class Transient;
+
+template <typename Tag,
+          typename Value,
+          typename Measure,
+          typename Allocator,
+          typename Ownership>
 class Branch {
-    Tag                               tag_;
-    std::shared_ptr<Tree<Tag, Value>> left_;
-    std::shared_ptr<Tree<Tag, Value>> right_;
+    using Tree_ = Tree<Tag, Value, Measure, Allocator, Ownership>;
+    using Ptr_  = typename Ownership::template Ptr<Tree_>;
+
+    Tag          tag_;
+    std::size_t  size_;
+    Ptr_         left_;
+    Ptr_         right_;
+    Tree_ const* front_;
+    Tree_ const* back_;
+
+    friend class Transient<Tree_>;
+    friend class Suspension<Tag, Value, Measure, Allocator, Ownership>;
+
+    // The end leaves of 'node', found through the fingers its root caches.
+    // The leaves are owned through the children, so the fingers stay valid
+    // for as long as the branch does.
+    // A suspended node is its own finger, so building a branch over one does
+    // not force it.
+    static auto leftmost(Tree_ const* node) -> Tree_ const* {
+        if (node->isSuspended()) {
+            return node;
+        }
+        auto const* b = node->asBranch();
+        return b != nullptr ? b->front_ : node;
+    }
+
+    static auto rightmost(Tree_ const* node) -> Tree_ const* {
+        if (node->isSuspended()) {
+            return node;
+        }
+        auto const* b = node->asBranch();
+        return b != nullptr ? b->back_ : node;
+    }
+
+    // Releases 'node' without recursing.  While the subtree is owned by
+    // 'node' alone, it is rotated until its root has no owned branch on the
+    // left.  The root is then detached from its right child and freed, and
+    // the teardown moves on to that child.  Shared subtrees only lose a
+    // reference, so any depth is torn down in constant stack space.
+    static void release(Ptr_ node) {
+        while (node && sole_owner(node)) {
+            auto* b = std::get_if<Branch>(&node->data_);
+            if (b == nullptr) {
+                return;
+            }
+            auto* lb = b->left_ && sole_owner(b->left_)
+                         ? std::get_if<Branch>(&b->left_->data_)
+                         : nullptr;
+            if (lb != nullptr) {
+                auto top   = std::move(b->left_);
+                b->left_   = std::move(lb->right_);
+                lb->right_ = std::move(node);
+                node       = std::move(top);
+            } else {
+                auto next = std::move(b->right_);
+                b->left_  = Ptr_();
+                node      = std::move(next);
+            }
+        }
+    }
 
   public:
-    Branch() : tag_(0), left_(0), right_(0) {}
-    Branch(Tag                               tag,
-           std::shared_ptr<Tree<Tag, Value>> left,
-           std::shared_ptr<Tree<Tag, Value>> right)
-        : tag_(tag), left_(left), right_(right) {}
-    auto tag() const -> Tag { return tag_; }
-    auto left() const { return left_; }
-    auto right() const { return right_; }
+    Branch()
+        : tag_(0),
+          size_(0),
+          left_(),
+          right_(),
+          front_(nullptr),
+          back_(nullptr) {}
+    Branch(Tag tag, Ptr_ left, Ptr_ right)
+        : tag_(tag),
+          size_(left->size() + right->size()),
+          left_(std::move(left)),
+          right_(std::move(right)),
+          front_(leftmost(left_.get())),
+          back_(rightmost(right_.get())) {}
+    Branch(Branch const&)                    = default;
+    Branch(Branch&&)                         = default;
+    auto operator=(Branch const&) -> Branch& = default;
+    auto operator=(Branch&&) -> Branch&      = default;
+    ~Branch() {
+        release(std::move(left_));
+        release(std::move(right_));
+    }
+    auto tag() const -> Tag const& { return tag_; }
+    auto size() const -> std::size_t { return size_; }
+    auto left() const -> Ptr_ const& { return left_; }
+    auto right() const -> Ptr_ const& { return right_; }
+    auto front() const -> Tree_ const* { return front_; }
+    auto back() const -> Tree_ const* { return back_; }
 };
 
-template <typename Tag, typename Value>
+template <typename Tag,
+          typename Value,
+          typename Measure,
+          typename Allocator,
+          typename Ownership>
 class Leaf {
-    Tag   tag_;
     Value v_;
+    Tag   tag_;
 
   public:
-    Leaf() : tag_(0), v_(0){};
-    Leaf(Tag tag, Value v) : tag_(tag), v_(v) {}
-    auto tag() const -> Tag { return tag_; }
-    auto value() const -> Value { return v_; }
+    Leaf() : v_(0), tag_(0){};
+    Leaf(Tag tag, Value v) : v_(std::move(v)), tag_(tag) {}
+
+    // Builds the value in place from 'args'.
+    template <typename... Args>
+    explicit Leaf(std::in_place_t, Args&&... args)
+        : v_(std::forward<Args>(args)...), tag_(Measure::leaf(v_)) {}
+
+    auto tag() const -> Tag const& { return tag_; }
+    auto size() const -> std::size_t { return 1; }
+    auto value() const -> Value const& { return v_; }
 };
 
-template <typename Tag, typename Value>
+template <typename Tag,
+          typename Value,
+          typename Measure,
+          typename Allocator,
+          typename Ownership>
 class Empty {
   public:
     Empty(){};
-    auto tag() const -> Tag { return {}; };
+    auto tag() const -> Tag { return Measure::identity(); };
+    auto size() const -> std::size_t { return 0; }
+};
+
+// A node whose contents are computed on first access, by running 'thunk' once
+// and keeping its result.  The size is always known up front and the tag
+// usually is; when it is not, asking for it forces the node.  The node never
+// changes kind: once forced it stands for its result, which every accessor of
+// 'Tree' reaches through it, so no visitor ever sees a suspension.  Forcing is
+// safe from any number of threads and runs 'thunk' exactly once, unless it
+// throws, in which case the next access tries again.
+//
+// The nodes a thunk reads are its inputs, which the suspension holds and
+// passes to it rather than the thunk capturing them.  Suspended inputs are
+// forced before the thunk runs, and forcing keeps the chain of suspensions
+// still to run on a work list, so a suspension built on a chain of others
+// of any length is forced, and freed, in constant stack space.
+template <typename Tag,
+          typename Value,
+          typename Measure,
+          typename Allocator,
+          typename Ownership>
+class Suspension {
+    using Tree_   = Tree<Tag, Value, Measure, Allocator, Ownership>;
+    using Ptr_    = typename Ownership::template Ptr<Tree_>;
+    using Branch_ = Branch<Tag, Value, Measure, Allocator, Ownership>;
+
+  public:
+    using Inputs_ = std::array<Ptr_, 2>;
+    using Thunk_  = std::function<Ptr_(Inputs_ const&)>;
+
+  private:
+    // Kept out of line so that a suspension is no larger than a branch.
+    struct State {
+        std::mutex        mutex_;
+        std::atomic<bool> done_{false};
+        Thunk_            thunk_;
+        Inputs_           inputs_;
+        Ptr_              forced_;
+
+        State(Thunk_ thunk, Inputs_ inputs)
+            : thunk_(std::move(thunk)), inputs_(std::move(inputs)) {}
+    };
+
+    std::optional<Tag>     tag_;
+    std::size_t            size_;
+    std::unique_ptr<State> state_;
+
+    // The suspension 'node' is, if it has yet to be forced.
+    static auto pending(Ptr_ const& node) -> Suspension const* {
+        auto const* s = node ? std::get_if<Suspension>(&node->data_) : nullptr;
+        if (s == nullptr || s->state_->done_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return s;
+    }
+
+    // Runs the thunks of 'top' and of the suspended inputs below it,
+    // deepest first.  While one of its inputs is pending a suspension waits
+    // on 'below', holding a reference to the input it went on to, which
+    // keeps that input alive if another thread forces it and drops it in
+    // the meantime.  Each suspension is locked while it is looked at and
+    // while its thunk runs.
+    static void run(Suspension const* top) {
+        std::vector<std::pair<Suspension const*, Ptr_>> below;
+        auto const*                                     s = top;
+        Ptr_                                            held;
+        for (;;) {
+            auto*                        state = s->state_.get();
+            std::unique_lock<std::mutex> lock(state->mutex_);
+            if (!state->done_.load(std::memory_order_relaxed)) {
+                Suspension const* next = nullptr;
+                for (auto const& input : state->inputs_) {
+                    if ((next = pending(input)) != nullptr) {
+                        below.push_back({s, std::move(held)});
+                        held = input;
+                        s    = next;
+                        break;
+                    }
+                }
+                if (next != nullptr) {
+                    lock.unlock();
+                    continue;
+                }
+                state->forced_ = state->thunk_(state->inputs_);
+                state->thunk_  = nullptr;
+                state->inputs_ = Inputs_();
+                state->done_.store(true, std::memory_order_release);
+            }
+            if (below.empty()) {
+                return;
+            }
+            lock.unlock();
+            s    = below.back().first;
+            held = std::move(below.back().second);
+            below.pop_back();
+        }
+    }
+
+    // Moves what 'state' holds onto 'owned' when it is held nowhere else and
+    // could hold more nodes, and otherwise drops it.
+    static void take(State& state, std::vector<Ptr_>& owned) {
+        state.thunk_ = nullptr;
+        auto keep    = [&owned](Ptr_& node) {
+            if (node && sole_owner(node) &&
+                (std::holds_alternative<Suspension>(node->data_) ||
+                 std::holds_alternative<Branch_>(node->data_))) {
+                owned.push_back(std::move(node));
+            }
+            node = Ptr_();
+        };
+        for (auto& input : state.inputs_) {
+            keep(input);
+        }
+        keep(state.forced_);
+    }
+
+    // Frees what the suspension owns without recursing.  Nodes nothing else
+    // refers to are taken apart on a work list, suspensions into their
+    // inputs and results and branches into their children, and each is
+    // freed once it holds nothing.
+    void release() {
+        std::vector<Ptr_> owned;
+        take(*state_, owned);
+        while (!owned.empty()) {
+            auto node = std::move(owned.back());
+            owned.pop_back();
+            if (auto* s = std::get_if<Suspension>(&node->data_)) {
+                if (s->state_) {
+                    take(*s->state_, owned);
+                }
+            } else if (auto* b = std::get_if<Branch_>(&node->data_)) {
+                for (auto* child : {&b->left_, &b->right_}) {
+                    if (sole_owner(*child)) {
+                        owned.push_back(std::move(*child));
+                    }
+                    *child = Ptr_();
+                }
+            }
+        }
+    }
+
+  public:
+    Suspension(std::optional<Tag> tag,
+               std::size_t        size,
+               Thunk_             thunk,
+               Inputs_            inputs)
+        : tag_(std::move(tag)),
+          size_(size),
+          state_(new State(std::move(thunk), std::move(inputs))) {}
+    Suspension(Suspension&&) = default;
+    ~Suspension() {
+        if (state_) {
+            release();
+        }
+    }
+
+    auto tag() const -> Tag { return tag_ ? *tag_ : force()->tag(); }
+    auto size() const -> std::size_t { return size_; }
+
+    // The tag given up front, if there was one.
+    auto knownTag() const -> std::optional<Tag> const& { return tag_; }
+
+    bool isForced() const {
+        return state_->done_.load(std::memory_order_acquire);
+    }
+
+    // The nodes the suspension holds: its result once it has been forced,
+    // and otherwise its inputs.
+    auto held() const -> Inputs_ {
+        std::lock_guard<std::mutex> lock(state_->mutex_);
+        if (state_->done_.load(std::memory_order_relaxed)) {
+            return {state_->forced_, Ptr_()};
+        }
+        return state_->inputs_;
+    }
+
+    // The result of the suspended computation.  The thunk and its inputs are
+    // dropped once it has run, releasing what they held.
+    auto force() const -> Ptr_ const& {
+        if (!state_->done_.load(std::memory_order_acquire)) {
+            run(this);
+        }
+        return state_->forced_;
+    }
+
+    // Forces the suspension and hands over its result, for a caller holding
+    // the only reference to it.
+    auto take() -> Ptr_ {
+        force();
+        return std::move(state_->forced_);
+    }
 };
 
-template <typename Tag, typename Value>
-class Tree {
+template <typename Tag,
+          typename Value,
+          typename Measure,
+          typename Allocator,
+          typename Ownership>
+class Tree : public Ownership::template Hook<
+                 Tree<Tag, Value, Measure, Allocator, Ownership>,
+                 Allocator> {
   public:
-    using Tag_    = Tag;
-    using Value_  = Value;
-    using Leaf_   = Leaf<Tag, Value>;
-    using Branch_ = Branch<Tag, Value>;
-    using Empty_  = Empty<Tag, Value>;
+    using Tag_           = Tag;
+    using Value_         = Value;
+    using Measure_       = Measure;
+    using Allocator_     = Allocator;
+    using Ownership_     = Ownership;
+    using Ptr_           = typename Ownership::template Ptr<Tree>;
+    using Leaf_          = Leaf<Tag, Value, Measure, Allocator, Ownership>;
+    using Branch_        = Branch<Tag, Value, Measure, Allocator, Ownership>;
+    using Empty_         = Empty<Tag, Value, Measure, Allocator, Ownership>;
+    using Suspension_ =
+        Suspension<Tag, Value, Measure, Allocator, Ownership>;
+    using const_iterator = LeafIterator<Tree>;
+    using iterator       = const_iterator;
 
   private:
-    std::variant<Empty_, Leaf_, Branch_> data_;
+    std::variant<Empty_, Leaf_, Branch_, Suspension_> data_;
+
+    friend class Transient<Tree>;
+    friend Branch_;
+    friend Suspension_;
+
+    // What a suspended node stands for, through any chain of suspensions.
+    // Kept out of line, so that the accessors' common case stays a single
+    // test of the node's kind.
+    [[gnu::noinline]] auto forced() const -> Tree const* {
+        auto const* node = this;
+        while (auto const* s = std::get_if<Suspension_>(&node->data_)) {
+            node = s->force().get();
+        }
+        return node;
+    }
+
+    // Builds the next 'n' values from 'it', splitting them in half so that
+    // sibling subtrees differ in size by at most one.
+    template <typename Iterator>
+    static auto build_(Iterator& it, std::size_t n) -> Ptr_ {
+        if (n == 0) {
+            return empty();
+        }
+        if (n == 1) {
+            auto l = leaf(*it);
+            ++it;
+            return l;
+        }
+        auto left  = build_(it, n / 2);
+        auto right = build_(it, n - n / 2);
+        return branch(std::move(left), std::move(right));
+    }
 
   public:
     Tree(Empty_ const& empty) : data_(empty) {}
     Tree(Leaf_ const& leaf) : data_(leaf) {}
+    Tree(Leaf_&& leaf) : data_(std::move(leaf)) {}
     Tree(Branch_ const& branch) : data_(branch) {}
+    Tree(Branch_&& branch) : data_(std::move(branch)) {}
+    Tree(Suspension_&& suspension) : data_(std::move(suspension)) {}
+
+    template <typename... Args>
+    explicit Tree(std::in_place_type_t<Leaf_>, Args&&... args)
+        : data_(std::in_place_type<Leaf_>,
+                std::in_place,
+                std::forward<Args>(args)...) {}
 
-    auto tag() -> Tag {
+    auto tag() const -> Tag {
         return std::visit([](auto&& v) { return v.tag(); }, data_);
     }
 
-    static auto empty() -> std::shared_ptr<Tree> {
-        return std::make_shared<Tree>(Empty_{});
+    // The tag, if it can be had without forcing anything: a suspension knows
+    // it when it was given up front or once it has been forced.
+    auto knownTag() const -> std::optional<Tag> {
+        auto const* node = this;
+        while (auto const* s = std::get_if<Suspension_>(&node->data_)) {
+            if (s->knownTag() || !s->isForced()) {
+                return s->knownTag();
+            }
+            node = s->force().get();
+        }
+        return node->tag();
+    }
+
+    auto size() const -> std::size_t {
+        return std::visit([](auto&& v) { return v.size(); }, data_);
+    }
+
+    // Every empty tree of a type is the same immortal node, allocated
+    // outside 'Allocator' so that it can outlive any resource.
+    static auto empty() -> Ptr_ {
+        static Ptr_ const e = Ownership::template make_static<Tree>(Empty_{});
+        return e;
     }
 
-    static auto leaf(Value const& v) -> std::shared_ptr<Tree> {
-        return std::make_shared<Tree>(Leaf_{1, v});
+    static auto leaf(Value const& v) -> Ptr_ { return leaf_emplace(v); }
+
+    static auto leaf(Value&& v) -> Ptr_ { return leaf_emplace(std::move(v)); }
+
+    // Constructs the leaf's value directly inside the new node.
+    template <typename... Args>
+    static auto leaf_emplace(Args&&... args) -> Ptr_ {
+        return Ownership::template make<Tree>(Allocator{},
+                                              std::in_place_type<Leaf_>,
+                                              std::forward<Args>(args)...);
     }
 
-    static auto branch(std::shared_ptr<Tree> left, std::shared_ptr<Tree> right)
-        -> std::shared_ptr<Tree> {
-        return std::make_shared<Tree>(
-            Branch_{(left->tag() + right->tag()), left, right});
+    // Never builds a branch with an empty child: joining anything with an
+    // empty tree returns the other tree unchanged.  A child whose tag is not
+    // known yet is not forced for it; the branch is suspended instead, and
+    // built when it is first looked into.
+    static auto branch(Ptr_ left, Ptr_ right) -> Ptr_ {
+        if (left->isEmpty()) {
+            return right;
+        }
+        if (right->isEmpty()) {
+            return left;
+        }
+        auto leftTag  = left->knownTag();
+        auto rightTag = right->knownTag();
+        if (!leftTag || !rightTag) {
+            auto size = left->size() + right->size();
+            return suspend(
+                std::nullopt,
+                size,
+                [](auto const& in) { return branch(in[0], in[1]); },
+                {std::move(left), std::move(right)});
+        }
+        auto tag = Measure::combine(*leftTag, *rightTag);
+        return Ownership::template make<Tree>(
+            Allocator{}, Branch_{tag, std::move(left), std::move(right)});
+    }
+
+    // A node of 'size' leaves, computed by 'thunk' from 'inputs' when first
+    // needed.  A suspension is never empty: a computation known to be empty
+    // is just 'empty()'.
+    static auto suspend(std::optional<Tag>                  tag,
+                        std::size_t                         size,
+                        typename Suspension_::Thunk_        thunk,
+                        typename Suspension_::Inputs_ inputs = {}) -> Ptr_ {
+        if (size == 0) {
+            return empty();
+        }
+        return Ownership::template make<Tree>(
+            Allocator{},
+            Suspension_{
+                std::move(tag), size, std::move(thunk), std::move(inputs)});
+    }
+
+    // The node 'node' stands for, forcing it and any suspension it returns.
+    // A suspension held nowhere else hands over its result, so the result may
+    // come back owned by the caller alone.
+    static auto resolve(Ptr_ node) -> Ptr_ {
+        while (auto* s = std::get_if<Suspension_>(&node->data_)) {
+            Ptr_ forced = sole_owner(node) ? s->take() : s->force();
+            node        = std::move(forced);
+        }
+        return node;
+    }
+
+    // Builds a perfectly balanced tree of '[first, last)' in O(n), allocating
+    // exactly one node per leaf and branch.  Values are moved in when the
+    // iterators yield rvalues, e.g. 'std::move_iterator'.  Single-pass input
+    // is buffered first so that its length is known before building.
+    template <typename Iterator>
+    static auto from_range(Iterator first, Iterator last) -> Ptr_ {
+        using Category =
+            typename std::iterator_traits<Iterator>::iterator_category;
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                                        Category>) {
+            auto n = static_cast<std::size_t>(std::distance(first, last));
+            return build_(first, n);
+        } else {
+            std::vector<Value> values(first, last);
+            auto               it = std::make_move_iterator(values.begin());
+            return build_(it, values.size());
+        }
     }
 
+    static auto from_range(std::initializer_list<Value> values) -> Ptr_ {
+        return from_range(values.begin(), values.end());
+    }
+
+    // Visits what the node stands for, so 'c' sees only empties, leaves and
+    // branches.
     template <typename Callable>
     auto visit(Callable&& c) const {
-        return std::visit(c, data_);
+        if (auto const* l = std::get_if<Leaf_>(&data_)) {
+            return c(*l);
+        }
+        if (auto const* b = std::get_if<Branch_>(&data_)) {
+            return c(*b);
+        }
+        if (isSuspended()) {
+            return forced()->visit(c);
+        }
+        return c(*std::get_if<Empty_>(&data_));
+    }
+
+    bool isEmpty() const { return std::holds_alternative<Empty_>(data_); }
+
+    bool isSuspended() const {
+        return std::holds_alternative<Suspension_>(data_);
+    }
+
+    // Whether the node is a suspension that has yet to be forced.
+    bool isPending() const {
+        auto const* s = std::get_if<Suspension_>(&data_);
+        return s != nullptr && !s->isForced();
+    }
+
+    // The nodes a suspension holds, found without forcing it, or none for
+    // any other node.  Unused slots are null.
+    auto held() const -> typename Suspension_::Inputs_ {
+        auto const* s = std::get_if<Suspension_>(&data_);
+        return s != nullptr ? s->held() : typename Suspension_::Inputs_();
+    }
+
+    auto asLeaf() const -> Leaf_ const* {
+        if (auto const* l = std::get_if<Leaf_>(&data_)) {
+            return l;
+        }
+        return isSuspended() ? std::get_if<Leaf_>(&forced()->data_) : nullptr;
+    }
+
+    auto asBranch() const -> Branch_ const* {
+        if (auto const* b = std::get_if<Branch_>(&data_)) {
+            return b;
+        }
+        return isSuspended() ? std::get_if<Branch_>(&forced()->data_)
+                             : nullptr;
+    }
+
+    auto begin() const -> const_iterator {
+        return const_iterator(this, false);
+    }
+
+    auto end() const -> const_iterator { return const_iterator(this, true); }
+};
+
+// The operations that follow one path down a tree and rebuild it on the way
+// back keep that path here rather than on the call stack, so that a tree
+// built directly with 'Tree::branch' can be arbitrarily deep.  Paths through
+// balanced trees fit in the inline buffer; deeper ones spill to the heap.
+// 'LeafIterator' keeps its path here too, so that neither making nor copying
+// an iterator allocates.  A copy copies only the frames in use.  Frames are
+// moved in and out, so a frame may own what it refers to.
+template <typename T>
+class PathStack {
+    static constexpr std::size_t inline_ = 64;
+
+    T              local_[inline_];
+    std::vector<T> spill_;
+    std::size_t    size_ = 0;
+
+  public:
+    PathStack() = default;
+
+    PathStack(PathStack const& other)
+        : spill_(other.spill_), size_(other.size_) {
+        std::copy(other.local_,
+                  other.local_ + std::min(size_, inline_),
+                  local_);
+    }
+
+    auto operator=(PathStack const& other) -> PathStack& {
+        std::copy(other.local_,
+                  other.local_ + std::min(other.size_, inline_),
+                  local_);
+        spill_ = other.spill_;
+        size_  = other.size_;
+        return *this;
+    }
+
+    void push(T t) {
+        if (size_ < inline_) {
+            local_[size_] = std::move(t);
+        } else {
+            spill_.push_back(std::move(t));
+        }
+        ++size_;
+    }
+
+    auto pop() -> T {
+        --size_;
+        if (size_ < inline_) {
+            return std::move(local_[size_]);
+        }
+        auto t = std::move(spill_.back());
+        spill_.pop_back();
+        return t;
+    }
+
+    auto operator[](std::size_t i) -> T& {
+        return i < inline_ ? local_[i] : spill_[i - inline_];
+    }
+
+    auto operator[](std::size_t i) const -> T const& {
+        return i < inline_ ? local_[i] : spill_[i - inline_];
+    }
+
+    auto back() -> T& { return (*this)[size_ - 1]; }
+    auto back() const -> T const& { return (*this)[size_ - 1]; }
+
+    auto size() const -> std::size_t { return size_; }
+    bool empty() const { return size_ == 0; }
+};
+
+// Bidirectional iterator over the values in the leaves of a tree, in order.
+// It keeps the path from the root to the current leaf as borrowed pointers,
+// so stepping does no reference counting and copies no values.  The path is
+// held inline, so the iterator allocates only for a path of more than 64
+// frames, which no weight-balanced tree of fewer than about 50 million
+// leaves has.
+template <typename Tree>
+class LeafIterator {
+    struct Frame {
+        Tree const* node_;
+        bool        right_;
+    };
+
+    Tree const*      root_;
+    PathStack<Frame> path_;
+
+    void descend(Tree const* node, bool right) {
+        while (auto const* b = node->asBranch()) {
+            path_.push(Frame{node, right});
+            node = right ? b->right().get() : b->left().get();
+        }
+        path_.push(Frame{node, false});
+    }
+
+    void step(bool right) {
+        path_.pop();
+        while (!path_.empty()) {
+            auto& frame = path_.back();
+            auto const* b = frame.node_->asBranch();
+            auto const& next = right ? b->right() : b->left();
+            if (frame.right_ != right) {
+                frame.right_ = right;
+                descend(next.get(), !right);
+                return;
+            }
+            path_.pop();
+        }
+    }
+
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type        = typename Tree::Value_;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = value_type const*;
+    using reference         = value_type const&;
+
+    LeafIterator() : root_(nullptr) {}
+
+    LeafIterator(Tree const* root, bool atEnd) : root_(root) {
+        if (!atEnd && root->size() != 0) {
+            descend(root, false);
+        }
+    }
+
+    auto operator*() const -> reference {
+        return path_.back().node_->asLeaf()->value();
     }
 
-    bool isEmpty() { return std::holds_alternative<Empty_>(data_); }
+    auto operator->() const -> pointer { return &**this; }
+
+    auto operator++() -> LeafIterator& {
+        step(true);
+        return *this;
+    }
+
+    auto operator++(int) -> LeafIterator {
+        auto tmp = *this;
+        ++*this;
+        return tmp;
+    }
+
+    auto operator--() -> LeafIterator& {
+        if (path_.empty()) {
+            descend(root_, true);
+        } else {
+            step(false);
+        }
+        return *this;
+    }
+
+    auto operator--(int) -> LeafIterator {
+        auto tmp = *this;
+        --*this;
+        return tmp;
+    }
+
+    friend bool operator==(LeafIterator const& lhs, LeafIterator const& rhs) {
+        if (lhs.path_.size() != rhs.path_.size()) {
+            return false;
+        }
+        for (auto i = lhs.path_.size(); i-- != 0;) {
+            if (lhs.path_[i].node_ != rhs.path_[i].node_ ||
+                lhs.path_[i].right_ != rhs.path_[i].right_) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    friend bool operator!=(LeafIterator const& lhs, LeafIterator const& rhs) {
+        return !(lhs == rhs);
+    }
 };
 
 constexpr auto tag = [](auto tree) { return tree->tag(); };
 
 constexpr inline struct breadth {
-    template <typename T, typename V>
-    auto operator()(Empty<T, V> const&) const -> T {
+    template <typename T, typename V, typename... P>
+    auto operator()(Empty<T, V, P...> const&) const -> std::size_t {
         return 0;
     }
 
-    template <typename T, typename V>
-    auto operator()(Leaf<T, V> const&) const -> T {
+    template <typename T, typename V, typename... P>
+    auto operator()(Leaf<T, V, P...> const&) const -> std::size_t {
         return 1;
     }
 
-    template <typename T, typename V>
-    auto operator()(Branch<T, V> const& b) const -> T {
-        return b.left()->visit(*this) + b.right()->visit(*this);
+    // Every branch already counts its leaves.
+    template <typename T, typename V, typename... P>
+    auto operator()(Branch<T, V, P...> const& b) const -> std::size_t {
+        return b.size();
     }
 } breadth_;
 
 constexpr auto breadth = [](auto tree) { return tree->visit(breadth_); };
 
 constexpr inline struct depth {
-    template <typename T, typename V>
-    auto operator()(Empty<T, V> const&) const -> T {
+    template <typename T, typename V, typename... P>
+    auto operator()(Empty<T, V, P...> const&) const -> std::size_t {
         return 0;
     }
 
-    template <typename T, typename V>
-    auto operator()(Leaf<T, V> const&) const -> T {
+    template <typename T, typename V, typename... P>
+    auto operator()(Leaf<T, V, P...> const&) const -> std::size_t {
         return 1;
     }
 
-    template <typename T, typename V>
-    auto operator()(Branch<T, V> const& b) const -> T {
-        auto leftDepth  = (b.left()->visit(*this)) + 1;
-        auto rightDepth = (b.right()->visit(*this)) + 1;
-
-        return (leftDepth > rightDepth) ? leftDepth : rightDepth;
+    // Walks the subtrees with an explicit stack, since a tree built directly
+    // with 'Tree::branch' can be arbitrarily deep.
+    template <typename T, typename V, typename... P>
+    auto operator()(Branch<T, V, P...> const& b) const -> std::size_t {
+        using Frame = std::pair<Tree<T, V, P...> const*, std::size_t>;
+        std::vector<Frame> stack{{b.left().get(), 2}, {b.right().get(), 2}};
+        std::size_t        deepest = 1;
+        while (!stack.empty()) {
+            auto [node, level] = stack.back();
+            stack.pop_back();
+            if (auto const* nb = node->asBranch()) {
+                stack.push_back({nb->left().get(), level + 1});
+                stack.push_back({nb->right().get(), level + 1});
+            } else {
+                deepest = std::max(deepest, level);
+            }
+        }
+        return deepest;
     }
 } depth_;
 
 constexpr auto depth = [](auto tree) { return tree->visit(depth_); };
 
 constexpr inline struct flatten {
-    template <typename T, typename V>
-    auto operator()(Empty<T, V> const&) const -> std::vector<V> {
+    template <typename T, typename V, typename... P>
+    auto operator()(Empty<T, V, P...> const&) const -> std::vector<V> {
         return std::vector<V>{};
     }
 
-    template <typename T, typename V>
-    auto operator()(Leaf<T, V> const& l) const -> std::vector<V> {
+    template <typename T, typename V, typename... P>
+    auto operator()(Leaf<T, V, P...> const& l) const -> std::vector<V> {
         std::vector<V> v;
         v.emplace_back(l.value());
         return v;
     }
 
-    template <typename T, typename V>
-    auto operator()(Branch<T, V> const& b) const -> std::vector<V> {
-        auto leftFlatten  = b.left()->visit(*this);
-        auto rightFlatten = b.right()->visit(*this);
-        leftFlatten.insert(
-            leftFlatten.end(), rightFlatten.begin(), rightFlatten.end());
-        return leftFlatten;
+    template <typename T, typename V, typename... P>
+    auto operator()(Branch<T, V, P...> const& b) const -> std::vector<V> {
+        std::vector<V> v;
+        v.reserve(b.size());
+        std::copy(b.left()->begin(), b.left()->end(), std::back_inserter(v));
+        std::copy(b.right()->begin(), b.right()->end(), std::back_inserter(v));
+        return v;
     }
 } flatten_;
 
 constexpr auto flatten = [](auto tree) { return tree->visit(flatten_); };
 
+constexpr auto flatten_into = [](auto tree, auto out) {
+    return std::copy(tree->begin(), tree->end(), out);
+};
+
 template <typename OS>
 struct printer_ {
     OS& os_;
     printer_(OS& os) : os_(os){};
 
-    template <typename T, typename U>
-    void operator()(Empty<T, U> const& e) const {
+    template <typename T, typename U, typename... P>
+    void operator()(Empty<T, U, P...> const& e) const {
         os_ << '"' << (&e) << '"' << '\n';
     }
 
-    template <typename T, typename U>
-    void operator()(Leaf<T, U> const& l) const {
+    template <typename T, typename U, typename... P>
+    void operator()(Leaf<T, U, P...> const& l) const {
         os_ << '"' << (&l) << '"'
             << " [shape=record label=\"<f1> value=" << l.value()
             << "\\n tag=" << l.tag() << "\"]\n";
     }
 
-    template <typename T, typename U>
-    void operator()(Branch<T, U> const& b) const {
-        os_ << '"' << (&b) << '"'
-            << " [shape=record label=\"<f0> | <f1> tag=" << b.tag()
-            << "| <f2>\" ]\n";
-        os_ << '"' << (&b) << "\":f0 -> \"" << (b.left().get()) << "\":f1\n";
-        os_ << '"' << (&b) << "\":f2 -> \"" << (b.right().get()) << "\":f1\n";
-        (b.left()->visit(*this));
-        (b.right()->visit(*this));
+    // Prints the subtrees in the same preorder as a recursive walk, keeping
+    // the subtrees still to be printed on an explicit stack.
+    template <typename T, typename U, typename... P>
+    void operator()(Branch<T, U, P...> const& b) const {
+        std::vector<Tree<T, U, P...> const*> stack;
+        for (auto const* top = &b; top != nullptr;) {
+            os_ << '"' << top << '"'
+                << " [shape=record label=\"<f0> | <f1> tag=" << top->tag()
+                << "| <f2>\" ]\n";
+            os_ << '"' << top << "\":f0 -> \"" << (top->left().get())
+                << "\":f1\n";
+            os_ << '"' << top << "\":f2 -> \"" << (top->right().get())
+                << "\":f1\n";
+            stack.push_back(top->right().get());
+            stack.push_back(top->left().get());
+            top = nullptr;
+            while (top == nullptr && !stack.empty()) {
+                auto const* node = stack.back();
+                stack.pop_back();
+                top = node->asBranch();
+                if (top == nullptr) {
+                    node->visit(*this);
+                }
+            }
+        }
     }
 };
 
@@ -204,6 +1004,60 @@ constexpr auto printer = [](auto& os, auto tree) {
     return;
 };
 
+// Trees grown through 'prepend', 'append' and the list views are kept weight
+// balanced: neither child of a branch holds more than 'delta' times the
+// leaves of its sibling, so depth stays logarithmic in the number of leaves.
+// 'balance' builds a branch from two subtrees, restoring the invariant with
+// a single or double rotation when one side has become too heavy.  The
+// rotated nodes are built directly, so 'balance' does constant work.
+constexpr inline struct balance {
+    static constexpr std::size_t delta = 3;
+    static constexpr std::size_t gamma = 2;
+
+    template <typename TreePtr>
+    static auto heavy(TreePtr const& a, TreePtr const& b) -> bool {
+        return a->size() > delta * b->size();
+    }
+
+    template <typename TreePtr>
+    auto operator()(TreePtr const& l, TreePtr const& r) const -> TreePtr {
+        if (l->isEmpty()) {
+            return r;
+        }
+        if (r->isEmpty()) {
+            return l;
+        }
+
+        using Tree_ = typename TreePtr::element_type;
+        if (heavy(r, l)) {
+            auto const* rb = r->asBranch();
+            if (rb->left()->size() < gamma * rb->right()->size()) {
+                return Tree_::branch(Tree_::branch(l, rb->left()),
+                                     rb->right());
+            }
+            auto const* rlb = rb->left()->asBranch();
+            return Tree_::branch(Tree_::branch(l, rlb->left()),
+                                 Tree_::branch(rlb->right(), rb->right()));
+        }
+
+        if (heavy(l, r)) {
+            auto const* lb = l->asBranch();
+            if (lb->right()->size() < gamma * lb->left()->size()) {
+                return Tree_::branch(lb->left(),
+                                     Tree_::branch(lb->right(), r));
+            }
+            auto const* lrb = lb->right()->asBranch();
+            return Tree_::branch(Tree_::branch(lb->left(), lrb->left()),
+                                 Tree_::branch(lrb->right(), r));
+        }
+
+        return Tree_::branch(l, r);
+    }
+} balance_;
+
+// 'v_' is moved into the one leaf the call creates, so the functor can be
+// called only once, as an rvalue.  A leaf that is already in the tree is
+// shared by the new branch, not copied.
 template <typename V>
 class prepend_ {
   private:
@@ -211,31 +1065,27 @@ class prepend_ {
 
   public:
     prepend_(V const& v) : v_(v){};
-    prepend_(V&& v) : v_(v){};
-
-    template <typename T, typename U>
-    auto operator()(Empty<T, U> const&) const -> std::shared_ptr<Tree<T, U>> {
-        return Tree<T, U>::leaf(v_);
-    }
-
-    template <typename T, typename U>
-    auto operator()(Leaf<T, U> const& l) const -> std::shared_ptr<Tree<T, U>> {
-        return Tree<T, U>::branch(Tree<T, U>::leaf(v_),
-                                  Tree<T, U>::leaf(l.value()));
-    }
-
-    template <typename T, typename U>
-    auto operator()(Branch<T, U> const& b) const
-        -> std::shared_ptr<Tree<T, U>> {
-        return Tree<T, U>::branch(Tree<T, U>::leaf(v_),
-                                  Tree<T, U>::branch(b.left(), b.right()));
-        ;
+    prepend_(V&& v) : v_(std::move(v)){};
+
+    template <typename TreePtr>
+    auto operator()(TreePtr const& tree) && -> TreePtr {
+        using Tree_ = typename TreePtr::element_type;
+        PathStack<typename Tree_::Branch_ const*> path;
+        auto const*                               node = &tree;
+        while (auto const* b = (*node)->asBranch()) {
+            path.push(b);
+            node = &b->left();
+        }
+        auto result = Tree_::branch(Tree_::leaf(std::move(v_)), *node);
+        while (!path.empty()) {
+            result = balance_(result, path.pop()->right());
+        }
+        return result;
     }
 };
 
 constexpr auto prepend = [](auto v, auto tree) {
-    prepend_ p(v);
-    return tree->visit(p);
+    return prepend_(std::move(v))(tree);
 };
 
 template <typename V>
@@ -245,39 +1095,38 @@ class append_ {
 
   public:
     append_(V const& v) : v_(v){};
-    append_(V&& v) : v_(v){};
-
-    template <typename T, typename U>
-    auto operator()(Empty<T, U> const&) const -> std::shared_ptr<Tree<T, U>> {
-        return Tree<T, U>::leaf(v_);
-    }
-
-    template <typename T, typename U>
-    auto operator()(Leaf<T, U> const& l) const -> std::shared_ptr<Tree<T, U>> {
-        return Tree<T, U>::branch(Tree<T, U>::leaf(l.value()),
-                                  Tree<T, U>::leaf(v_));
-    }
-
-    template <typename T, typename U>
-    auto operator()(Branch<T, U> const& b) const
-        -> std::shared_ptr<Tree<T, U>> {
-        return Tree<T, U>::branch(Tree<T, U>::branch(b.left(), b.right()),
-                                  Tree<T, U>::leaf(v_));
-        ;
+    append_(V&& v) : v_(std::move(v)){};
+
+    template <typename TreePtr>
+    auto operator()(TreePtr const& tree) && -> TreePtr {
+        using Tree_ = typename TreePtr::element_type;
+        PathStack<typename Tree_::Branch_ const*> path;
+        auto const*                               node = &tree;
+        while (auto const* b = (*node)->asBranch()) {
+            path.push(b);
+            node = &b->right();
+        }
+        auto result = Tree_::branch(*node, Tree_::leaf(std::move(v_)));
+        while (!path.empty()) {
+            result = balance_(path.pop()->left(), result);
+        }
+        return result;
     }
 };
 
 constexpr auto append = [](auto v, auto tree) {
-    append_ p(v);
-    return tree->visit(p);
+    return append_(std::move(v))(tree);
 };
 
+// The first or last leaf of a tree and the tree without it.  The view holds
+// the leaf itself, so 'value()' is a reference that stays valid for as long
+// as the view does.
 template <typename Tree>
 struct View {
   private:
     struct View_ {
-        typename Tree::Value_ v_;
-        std::shared_ptr<Tree> tree_;
+        typename Tree::Ptr_ leaf_;
+        typename Tree::Ptr_ tree_;
     };
 
     struct Nil_ {};
@@ -285,8 +1134,8 @@ struct View {
     std::variant<View_, Nil_> view_;
 
   public:
-    View(typename Tree::Value_ const& v, std::shared_ptr<Tree> t)
-        : view_(View_{v, t}) {}
+    View(typename Tree::Ptr_ leaf, typename Tree::Ptr_ t)
+        : view_(View_{std::move(leaf), std::move(t)}) {}
 
     View() : view_(Nil_{}) {}
 
@@ -294,144 +1143,512 @@ struct View {
 
     bool isView() { return std::holds_alternative<View_>(view_); }
 
-    auto value() { return std::get<View_>(view_).v_; }
-    auto tree() { return std::get<View_>(view_).tree_; }
+    auto value() const -> typename Tree::Value_ const& {
+        return std::get<View_>(view_).leaf_->asLeaf()->value();
+    }
+    auto leaf() const -> typename Tree::Ptr_ const& {
+        return std::get<View_>(view_).leaf_;
+    }
+    auto tree() const -> typename Tree::Ptr_ {
+        return std::get<View_>(view_).tree_;
+    }
 };
 
 constexpr inline struct view_l {
-    template <typename T, typename U>
-    auto operator()(Empty<T, U> const&) const -> View<Tree<T, U>> {
-        return View<Tree<T, U>>{};
+    template <typename TreePtr>
+    auto operator()(TreePtr const& tree) const
+        -> View<typename TreePtr::element_type> {
+        using Tree_ = typename TreePtr::element_type;
+        if (tree->isEmpty()) {
+            return View<Tree_>{};
+        }
+        PathStack<typename Tree_::Branch_ const*> path;
+        auto const*                               node = &tree;
+        while (auto const* b = (*node)->asBranch()) {
+            path.push(b);
+            node = &b->left();
+        }
+        auto rest = Tree_::empty();
+        while (!path.empty()) {
+            rest = balance_(rest, path.pop()->right());
+        }
+        return View<Tree_>{*node, std::move(rest)};
     }
+} view_l_;
+
+constexpr auto view_l = [](auto tree) { return view_l_(tree); };
 
-    template <typename T, typename U>
-    auto operator()(Leaf<T, U> const& l) const -> View<Tree<T, U>> {
-        return View<Tree<T, U>>{l.value(), Tree<T, U>::empty()};
+constexpr inline struct view_r {
+    template <typename TreePtr>
+    auto operator()(TreePtr const& tree) const
+        -> View<typename TreePtr::element_type> {
+        using Tree_ = typename TreePtr::element_type;
+        if (tree->isEmpty()) {
+            return View<Tree_>{};
+        }
+        PathStack<typename Tree_::Branch_ const*> path;
+        auto const*                               node = &tree;
+        while (auto const* b = (*node)->asBranch()) {
+            path.push(b);
+            node = &b->right();
+        }
+        auto rest = Tree_::empty();
+        while (!path.empty()) {
+            rest = balance_(path.pop()->left(), rest);
+        }
+        return View<Tree_>{*node, std::move(rest)};
     }
+} view_r_;
 
-    template <typename T, typename U>
-    auto operator()(Branch<T, U> const& b) const -> View<Tree<T, U>> {
-        if (b.left()->isEmpty() && b.right()->isEmpty()) {
-            return View<Tree<T, U>>{};
+constexpr auto view_r = [](auto tree) { return view_r_(tree); };
+
+// The first and last values refer into 'tree', like 'front()' and 'back()'
+// on a container.  Every branch caches its end leaves, so they are found in
+// constant time without building anything.  A finger may be a suspended
+// node, which is forced and stepped through in turn.
+constexpr inline struct head {
+    template <typename TreePtr>
+    auto operator()(TreePtr const& tree) const ->
+        typename TreePtr::element_type::Value_ const& {
+        auto const* node = tree.get();
+        auto const* leaf = node->asLeaf();
+        while (leaf == nullptr) {
+            auto const* b = node->asBranch();
+            if (b == nullptr) {
+                throw std::out_of_range("fringetree::head");
+            }
+            node = b->front();
+            leaf = node->asLeaf();
         }
+        return leaf->value();
+    }
+} head_;
 
-        if (b.left()->isEmpty()) {
-            return b.right()->visit(*this);
+constexpr auto head = [](auto const& tree) -> decltype(auto) {
+    return head_(tree);
+};
+
+constexpr auto tail = [](auto tree) { return view_l_(tree).tree(); };
+
+constexpr inline struct last {
+    template <typename TreePtr>
+    auto operator()(TreePtr const& tree) const ->
+        typename TreePtr::element_type::Value_ const& {
+        auto const* node = tree.get();
+        auto const* leaf = node->asLeaf();
+        while (leaf == nullptr) {
+            auto const* b = node->asBranch();
+            if (b == nullptr) {
+                throw std::out_of_range("fringetree::last");
+            }
+            node = b->back();
+            leaf = node->asLeaf();
         }
+        return leaf->value();
+    }
+} last_;
+
+constexpr auto last = [](auto const& tree) -> decltype(auto) {
+    return last_(tree);
+};
+
+constexpr auto init = [](auto tree) { return view_r_(tree).tree(); };
+
+constexpr auto is_empty = [](auto const& tree) { return tree->isEmpty(); };
 
-        auto r = b.left()->visit(*this);
-        return View<Tree<T, U>>{r.value(),
-                                Tree<T, U>::branch(r.tree(), b.right())};
+// The first or last value together with the rest of the tree, found in one
+// pass.  The value is copied out, since the leaf holding it may be shared;
+// 'view_l' and 'view_r' keep the leaf instead.
+constexpr inline struct pop_front {
+    template <typename TreePtr>
+    auto operator()(TreePtr const& tree) const
+        -> std::pair<typename TreePtr::element_type::Value_, TreePtr> {
+        auto view = view_l_(tree);
+        if (view.isNil()) {
+            throw std::out_of_range("fringetree::pop_front");
+        }
+        return {view.value(), view.tree()};
     }
-} view_l_;
+} pop_front_;
 
-constexpr auto view_l = [](auto tree) { return tree->visit(view_l_); };
+constexpr auto pop_front = [](auto const& tree) { return pop_front_(tree); };
 
-constexpr inline struct view_r {
-    template <typename T, typename U>
-    auto operator()(Empty<T, U> const&) const -> View<Tree<T, U>> {
-        return View<Tree<T, U>>{};
+constexpr inline struct pop_back {
+    template <typename TreePtr>
+    auto operator()(TreePtr const& tree) const
+        -> std::pair<typename TreePtr::element_type::Value_, TreePtr> {
+        auto view = view_r_(tree);
+        if (view.isNil()) {
+            throw std::out_of_range("fringetree::pop_back");
+        }
+        return {view.value(), view.tree()};
     }
+} pop_back_;
+
+constexpr auto pop_back = [](auto const& tree) { return pop_back_(tree); };
+
+// Joins two trees by walking down the outer spine of the heavier one until
+// it meets a subtree of comparable weight, linking there and rebalancing on
+// the way back up.  Only the nodes on that spine are rebuilt; everything else
+// is shared with the inputs.
+constexpr inline struct concat {
+    template <typename TreePtr>
+    auto operator()(TreePtr const& left, TreePtr const& right) const
+        -> TreePtr {
+        using Tree_ = typename TreePtr::element_type;
+        if (left->isEmpty()) {
+            return right;
+        }
+        if (right->isEmpty()) {
+            return left;
+        }
+
+        // Each frame is a branch of the heavier side that was opened, and
+        // whether it came from the left tree.
+        PathStack<std::pair<typename Tree_::Branch_ const*, bool>> path;
+        auto const* l = &left;
+        auto const* r = &right;
+        for (;;) {
+            if (balance::heavy(*l, *r)) {
+                auto const* b = (*l)->asBranch();
+                path.push({b, true});
+                l = &b->right();
+            } else if (balance::heavy(*r, *l)) {
+                auto const* b = (*r)->asBranch();
+                path.push({b, false});
+                r = &b->left();
+            } else {
+                break;
+            }
+        }
 
-    template <typename T, typename U>
-    auto operator()(Leaf<T, U> const& l) const -> View<Tree<T, U>> {
-        return View<Tree<T, U>>{l.value(), Tree<T, U>::empty()};
+        auto result = Tree_::branch(*l, *r);
+        while (!path.empty()) {
+            auto [b, fromLeft] = path.pop();
+            result = fromLeft ? balance_(b->left(), result)
+                              : balance_(result, b->right());
+        }
+        return result;
     }
+} concat_;
 
-    template <typename T, typename U>
-    auto operator()(Branch<T, U> const& b) const -> View<Tree<T, U>> {
-        if (b.left()->isEmpty() && b.right()->isEmpty()) {
-            return View<Tree<T, U>>{};
+constexpr auto concat = [](auto left, auto right) {
+    return concat_(left, right);
+};
+
+// Positional access follows the leaf counts cached in each branch down a
+// single path.  'split_at' and 'slice' rebuild only the nodes on the cut path
+// and share every other subtree with their input.
+constexpr inline struct index {
+    template <typename TreePtr>
+    auto operator()(TreePtr const& tree, std::size_t i) const ->
+        typename TreePtr::element_type::Value_ const& {
+        if (!(i < tree->size())) {
+            throw std::out_of_range("fringetree::index");
         }
 
-        if (b.right()->isEmpty()) {
-            return b.left()->visit(*this);
+        auto const* node = tree.get();
+        while (auto const* b = node->asBranch()) {
+            auto leftSize = b->left()->size();
+            if (i < leftSize) {
+                node = b->left().get();
+            } else {
+                i -= leftSize;
+                node = b->right().get();
+            }
         }
+        return node->asLeaf()->value();
+    }
+} index_;
+
+constexpr auto index = [](auto const& tree, auto i) -> decltype(auto) {
+    return index_(tree, i);
+};
 
-        auto r = b.right()->visit(*this);
-        return View<Tree<T, U>>{r.value(),
-                                Tree<T, U>::branch(b.left(), r.tree())};
+constexpr inline struct split_at {
+    template <typename TreePtr>
+    auto operator()(TreePtr const& tree, std::size_t i) const
+        -> std::pair<TreePtr, TreePtr> {
+        using Tree_ = typename TreePtr::element_type;
+        if (i == 0) {
+            return {Tree_::empty(), tree};
+        }
+        if (!(i < tree->size())) {
+            return {tree, Tree_::empty()};
+        }
+
+        // With 0 < i < size at every step, the cut always falls between the
+        // children of some branch on the way down.
+        PathStack<std::pair<typename Tree_::Branch_ const*, bool>> path;
+        auto const* b = tree->asBranch();
+        for (;;) {
+            auto leftSize = b->left()->size();
+            if (i < leftSize) {
+                path.push({b, true});
+                b = b->left()->asBranch();
+            } else if (leftSize < i) {
+                path.push({b, false});
+                i -= leftSize;
+                b = b->right()->asBranch();
+            } else {
+                break;
+            }
+        }
+
+        TreePtr l = b->left();
+        TreePtr r = b->right();
+        while (!path.empty()) {
+            auto [p, wentLeft] = path.pop();
+            if (wentLeft) {
+                r = concat_(r, p->right());
+            } else {
+                l = concat_(p->left(), l);
+            }
+        }
+        return {l, r};
     }
-} view_r_;
+} split_at_;
 
-constexpr auto view_r = [](auto tree) { return tree->visit(view_r_); };
+constexpr auto split_at = [](auto tree, auto i) { return split_at_(tree, i); };
 
-constexpr auto head = [](auto tree) {
-    auto view = tree->visit(view_l_);
-    return view.value();
+constexpr auto slice = [](auto tree, auto lo, auto hi) {
+    auto prefix = split_at_(tree, hi).first;
+    return split_at_(prefix, lo).second;
 };
 
-constexpr auto tail = [](auto tree) {
-    auto view = tree->visit(view_l_);
-    return view.tree();
-};
+// Splits at the first point where 'pred' holds of the measure accumulated
+// from the front, for any monotone predicate over the tree's measure.  Every
+// element whose prefix measure fails 'pred' is on the left; the element that
+// first satisfies it starts the right.
+template <typename Pred>
+class split_ {
+  private:
+    Pred pred_;
 
-constexpr auto last = [](auto tree) {
-    auto view = tree->visit(view_r_);
-    return view.value();
-};
+  public:
+    split_(Pred const& pred) : pred_(pred){};
+
+    template <typename TreePtr>
+    auto operator()(TreePtr const&                             tree,
+                    typename TreePtr::element_type::Tag_ const& acc) const
+        -> std::pair<TreePtr, TreePtr> {
+        using Tree_ = typename TreePtr::element_type;
+        using M     = typename Tree_::Measure_;
+        if (pred_(acc)) {
+            return {Tree_::empty(), tree};
+        }
+        if (!pred_(M::combine(acc, tree->tag()))) {
+            return {tree, Tree_::empty()};
+        }
 
-constexpr auto init = [](auto tree) {
-    auto view = tree->visit(view_r_);
-    return view.tree();
+        PathStack<std::pair<typename Tree_::Branch_ const*, bool>> path;
+        auto const* node = &tree;
+        auto        sum  = acc;
+        while (auto const* b = (*node)->asBranch()) {
+            auto leftSum = M::combine(sum, b->left()->tag());
+            if (pred_(leftSum)) {
+                path.push({b, true});
+                node = &b->left();
+            } else {
+                path.push({b, false});
+                sum  = leftSum;
+                node = &b->right();
+            }
+        }
+
+        auto l = Tree_::empty();
+        auto r = *node;
+        while (!path.empty()) {
+            auto [b, wentLeft] = path.pop();
+            if (wentLeft) {
+                r = concat_(r, b->right());
+            } else {
+                l = concat_(b->left(), l);
+            }
+        }
+        return {l, r};
+    }
 };
 
-constexpr auto is_empty = [](auto tree) {
-    auto view = tree->visit(view_r_);
-    return view.isNil();
+constexpr auto split = [](auto tree, auto pred) {
+    using Tree = typename decltype(tree)::element_type;
+    split_<decltype(pred)> s(pred);
+    return s(tree, Tree::Measure_::identity());
 };
 
-template <typename T, typename V>
-class concat_ {
-  private:
-    std::shared_ptr<Tree<T, V>> t_;
+// Every kind of node caches its tag, including the nodes of an 'Image'.
+constexpr inline struct measure {
+    template <typename Node>
+    auto operator()(Node const& node) const {
+        return node.tag();
+    }
+} measure_;
 
-  public:
-    concat_(std::shared_ptr<Tree<T, V>> const& t) : t_(t){};
-    concat_(std::shared_ptr<Tree<T, V>>&& t) : t_(t){};
+constexpr auto measure = [](auto tree) { return tree->visit(measure_); };
+
+// Walks the fringes of two trees in lockstep, one subtree at a time.
+// Whichever frontier subtree is larger is opened up, leaves are handed to
+// 'cmp' as they meet, and a subtree that is the same node on both sides is
+// skipped without being entered.  Returns the first non-zero result of
+// 'cmp', or orders the fringes by length if one is a prefix of the other.
+template <typename Tree>
+class Frontier {
+    std::vector<Tree const*> stack_;
 
-    auto operator()(Empty<T, V> const&) const -> std::shared_ptr<Tree<T, V>> {
-        return t_;
+    explicit Frontier(Tree const* root) {
+        if (!root->isEmpty()) {
+            stack_.push_back(root);
+        }
     }
 
-    auto operator()(Leaf<T, V> const& leaf) const
-        -> std::shared_ptr<Tree<T, V>> {
-        auto view = view_l_(leaf);
-        return append(view.value(), t_);
+    void open() {
+        auto const* b = stack_.back()->asBranch();
+        stack_.pop_back();
+        stack_.push_back(b->right().get());
+        stack_.push_back(b->left().get());
     }
 
-    auto operator()(Branch<T, V> const& branch) const
-        -> std::shared_ptr<Tree<T, V>> {
-        auto    view = view_l_(branch);
-        auto    left = append(view.value(), t_);
-        concat_ c(left);
-        return view.tree()->visit(c);
+  public:
+    template <typename Cmp>
+    static auto walk(Tree const* a, Tree const* b, Cmp const& cmp) -> int {
+        Frontier fa(a);
+        Frontier fb(b);
+
+        while (!fa.stack_.empty() && !fb.stack_.empty()) {
+            auto const* x = fa.stack_.back();
+            auto const* y = fb.stack_.back();
+            if (x == y) {
+                fa.stack_.pop_back();
+                fb.stack_.pop_back();
+                continue;
+            }
+
+            auto const* lx = x->asLeaf();
+            auto const* ly = y->asLeaf();
+            if (lx != nullptr && ly != nullptr) {
+                if (int c = cmp(lx->value(), ly->value())) {
+                    return c;
+                }
+                fa.stack_.pop_back();
+                fb.stack_.pop_back();
+                continue;
+            }
+
+            if (lx == nullptr && !(x->size() < y->size())) {
+                fa.open();
+            }
+            if (ly == nullptr && !(y->size() < x->size())) {
+                fb.open();
+            }
+        }
+
+        if (fa.stack_.empty()) {
+            return fb.stack_.empty() ? 0 : -1;
+        }
+        return 1;
     }
 };
 
-constexpr auto concat = [](auto left, auto right) {
-    concat_ c(left);
-    return right->visit(c);
+constexpr auto compare_fringe = [](auto a, auto b) {
+    using Tree = typename decltype(a)::element_type;
+    return Frontier<Tree>::walk(a.get(), b.get(), [](auto& x, auto& y) {
+        return (x < y) ? -1 : (y < x) ? 1 : 0;
+    });
 };
 
-constexpr inline struct measure {
-    template <typename Tag, typename Value>
-    auto operator()(Empty<Tag, Value> const& e) const -> Tag {
-        return e.tag();
+constexpr auto same_fringe = [](auto a, auto b) {
+    using Tree = typename decltype(a)::element_type;
+    if (a->size() != b->size()) {
+        return false;
     }
+    return 0 == Frontier<Tree>::walk(a.get(), b.get(), [](auto& x, auto& y) {
+               return (x == y) ? 0 : 1;
+           });
+};
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+// A minimal lazily evaluated sequence of references produced by a coroutine.
+template <typename T>
+class Generator {
+  public:
+    struct promise_type {
+        T const* value_;
+
+        auto get_return_object() -> Generator {
+            return Generator{
+                std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+        auto final_suspend() noexcept -> std::suspend_always { return {}; }
+        auto yield_value(T const& v) noexcept -> std::suspend_always {
+            value_ = std::addressof(v);
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { throw; }
+    };
 
-    template <typename Tag, typename Value>
-    auto operator()(Leaf<Tag, Value> const& l) const -> Tag {
-        return l.tag();
+    class iterator {
+        std::coroutine_handle<promise_type> h_;
+
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = T const*;
+        using reference         = T const&;
+
+        iterator() : h_(nullptr) {}
+        explicit iterator(std::coroutine_handle<promise_type> h) : h_(h) {}
+
+        auto operator*() const -> reference { return *h_.promise().value_; }
+        auto operator->() const -> pointer { return h_.promise().value_; }
+
+        auto operator++() -> iterator& {
+            h_.resume();
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(iterator const& it, std::default_sentinel_t) {
+            return it.h_ == nullptr || it.h_.done();
+        }
+    };
+
+    explicit Generator(std::coroutine_handle<promise_type> h) : h_(h) {}
+    Generator(Generator&& other) noexcept
+        : h_(std::exchange(other.h_, nullptr)) {}
+    Generator(Generator const&) = delete;
+    auto operator=(Generator other) noexcept -> Generator& {
+        std::swap(h_, other.h_);
+        return *this;
+    }
+    ~Generator() {
+        if (h_) {
+            h_.destroy();
+        }
     }
 
-    template <typename Tag, typename Value>
-    auto operator()(Branch<Tag, Value> const& b) const -> Tag {
-        return b.tag();
+    auto begin() -> iterator {
+        h_.resume();
+        return iterator{h_};
     }
-} measure_;
+    auto end() -> std::default_sentinel_t { return {}; }
 
-constexpr auto measure = [](auto tree) { return tree->visit(measure_); };
+  private:
+    std::coroutine_handle<promise_type> h_;
+};
+
+// Yields the values on the fringe of 'tree' one at a time, on demand.  The
+// generator holds its own reference to the tree.
+template <typename TreePtr>
+auto fringe(TreePtr tree)
+    -> Generator<typename TreePtr::element_type::Value_> {
+    for (auto const& v : *tree) {
+        co_yield v;
+    }
+}
+#endif
 
 // ============================================================================
 //              INLINE FUNCTION AND FUNCTION TEMPLATE DEFINITIONS
@@ -1,8 +1,20 @@
 #include <fringetree/fringetree.h>
+#include <fringetree/transient.h>
+#include <fringetree/testsupport.t.h>
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
 using namespace fringetree;
+using namespace fringetree::test;
 
 TEST(TreeTest, TestGTest) {
     ASSERT_EQ(1, 1);
@@ -41,7 +53,6 @@ TEST(TreeTest, makeBranch) {
 
 }
 
-
 TEST(TreeTest, breadth) {
     using Tree = Tree<int, int>;
     auto t = Tree::branch(
@@ -79,7 +90,7 @@ TEST(TreeTest, depth) {
         Tree::branch(Tree::empty(), Tree::leaf(1)),
         Tree::branch(Tree::leaf(2), Tree::empty())
         );
-    ASSERT_EQ(3, depth(t2));
+    ASSERT_EQ(2, depth(t2));
 }
 
 TEST(TreeTest, flatten) {
@@ -131,7 +142,6 @@ TEST(TreeTest, prepend) {
     auto t3_ = prepend(0, t3);
     ASSERT_EQ(expected3, flatten(t3_));
 
-
     auto l_ = prepend(0, Tree::leaf(1));
     ASSERT_EQ(std::vector({0,1}), flatten(l_));
 }
@@ -162,7 +172,6 @@ TEST(TreeTest, append) {
     auto t3_ = append(0, t3);
     ASSERT_EQ(expected3, flatten(t3_));
 
-
     auto l_ = append(0, Tree::leaf(1));
     ASSERT_EQ(std::vector({1,0}), flatten(l_));
 }
@@ -293,6 +302,50 @@ TEST(TreeTest, listOps) {
 
 }
 
+TEST(TreeTest, endFingers) {
+    using Tree = Tree<int, int>;
+    auto t     = Tree::empty();
+    for (int i = 0; i < 200; ++i) {
+        t = i % 3 == 0 ? prepend(i, t) : append(i, t);
+        ASSERT_EQ(*t->begin(), head(t));
+        ASSERT_EQ(*--t->end(), last(t));
+    }
+    ASSERT_TRUE(fingersHold(t));
+
+    auto c = concat(t, Tree::from_range({1000, 1001}));
+    ASSERT_TRUE(fingersHold(c));
+    ASSERT_EQ(1001, last(c));
+    auto [l, r] = split_at(c, 77);
+    ASSERT_TRUE(fingersHold(l));
+    ASSERT_TRUE(fingersHold(r));
+    ASSERT_EQ(fringetree::index(c, 76), last(l));
+    ASSERT_EQ(fringetree::index(c, 77), head(r));
+    ASSERT_TRUE(fingersHold(tail(c)));
+    ASSERT_TRUE(fingersHold(init(c)));
+
+    ASSERT_THROW(head(Tree::empty()), std::out_of_range);
+    ASSERT_THROW(last(Tree::empty()), std::out_of_range);
+}
+
+TEST(TreeTest, pop) {
+    using Tree = Tree<int, int>;
+    auto t     = Tree::from_range({1, 2, 3});
+
+    auto [front, rest] = pop_front(t);
+    ASSERT_EQ(1, front);
+    ASSERT_EQ((std::vector<int>{2, 3}), flatten(rest));
+
+    auto [back, init] = pop_back(rest);
+    ASSERT_EQ(3, back);
+    ASSERT_EQ((std::vector<int>{2}), flatten(init));
+
+    auto [only, none] = pop_front(init);
+    ASSERT_EQ(2, only);
+    ASSERT_TRUE(is_empty(none));
+    ASSERT_THROW(pop_front(none), std::out_of_range);
+    ASSERT_THROW(pop_back(none), std::out_of_range);
+}
+
 TEST(TreeTest, concat) {
     using Tree = Tree<int, int>;
     auto left = Tree::branch(
@@ -333,3 +386,611 @@ TEST(TreeTest, measure) {
     ASSERT_EQ(2, measure(branch1));
     ASSERT_EQ(3, measure(tree));
 }
+
+// The value is moved into the tree, so the functors run once, as rvalues.
+TEST(TreeTest, insertersRunOnce) {
+    using TreePtr = Ptr<Tree<int, int>>;
+    static_assert(std::is_invocable_v<prepend_<int>, TreePtr const&>);
+    static_assert(!std::is_invocable_v<prepend_<int>&, TreePtr const&>);
+    static_assert(std::is_invocable_v<append_<int>, TreePtr const&>);
+    static_assert(!std::is_invocable_v<append_<int> const&, TreePtr const&>);
+
+    auto t = append_<int>(2)(prepend_<int>(1)(Tree<int, int>::empty()));
+    ASSERT_EQ((std::vector<int>{1, 2}), flatten(t));
+}
+
+TEST(TreeTest, balancedPrepend) {
+    using Tree = Tree<int, int>;
+    auto             t = Tree::empty();
+    std::vector<int> expected;
+    for (int i = 0; i < 1000; ++i) {
+        t = prepend(i, t);
+        expected.insert(expected.begin(), i);
+        ASSERT_TRUE(isBalanced(t));
+    }
+    ASSERT_EQ(expected, flatten(t));
+    ASSERT_EQ(1000, measure(t));
+    ASSERT_LE(depth(t), 25);
+    ASSERT_EQ(999, head(t));
+    ASSERT_EQ(0, last(t));
+}
+
+TEST(TreeTest, balancedAppend) {
+    using Tree = Tree<int, int>;
+    auto             t = Tree::empty();
+    std::vector<int> expected;
+    for (int i = 0; i < 1000; ++i) {
+        t = append(i, t);
+        expected.push_back(i);
+        ASSERT_TRUE(isBalanced(t));
+    }
+    ASSERT_EQ(expected, flatten(t));
+    ASSERT_LE(depth(t), 25);
+}
+
+TEST(TreeTest, balancedMixed) {
+    using Tree = Tree<int, int>;
+    auto             t = Tree::empty();
+    std::vector<int> expected;
+    for (int i = 0; i < 2000; ++i) {
+        switch ((i * 7919) % 5) {
+        case 0:
+        case 1:
+            t = prepend(i, t);
+            expected.insert(expected.begin(), i);
+            break;
+        case 2:
+        case 3:
+            t = append(i, t);
+            expected.push_back(i);
+            break;
+        default:
+            if (expected.size() < 2) {
+                break;
+            }
+            t = tail(t);
+            expected.erase(expected.begin());
+            t = init(t);
+            expected.pop_back();
+            break;
+        }
+        ASSERT_TRUE(isBalanced(t));
+    }
+    ASSERT_EQ(expected, flatten(t));
+}
+
+TEST(TreeTest, prependShares) {
+    using Tree = Tree<int, int>;
+    auto t = Tree::empty();
+    for (int i = 0; i < 64; ++i) {
+        t = append(i, t);
+    }
+    auto t2 = prepend(-1, t);
+    ASSERT_EQ(t->asBranch()->right(), t2->asBranch()->right());
+}
+
+namespace {
+template <typename Tree>
+void collectNodes(std::shared_ptr<Tree> const& tree, std::set<Tree const*>& s) {
+    if (!s.insert(tree.get()).second) {
+        return;
+    }
+    if (auto const* b = tree->asBranch()) {
+        collectNodes(b->left(), s);
+        collectNodes(b->right(), s);
+    }
+}
+} // namespace
+
+TEST(TreeTest, concatBalanced) {
+    using Tree = Tree<int, int>;
+    for (int n : {0, 1, 2, 5, 17, 100, 1000}) {
+        for (int m : {0, 1, 3, 8, 64, 513, 2000}) {
+            auto l = build<Tree>(0, n);
+            auto r = build<Tree>(n, n + m);
+            auto c = concat(l, r);
+
+            std::vector<int> expected(n + m);
+            std::iota(expected.begin(), expected.end(), 0);
+            ASSERT_EQ(expected, flatten(c));
+            ASSERT_EQ(n + m, measure(c));
+            ASSERT_TRUE(isBalanced(c));
+        }
+    }
+}
+
+TEST(TreeTest, concatShares) {
+    using Tree = Tree<int, int>;
+    auto l = build<Tree>(0, 10000);
+    auto r = build<Tree>(10000, 10010);
+
+    std::set<Tree const*> inputs;
+    collectNodes(l, inputs);
+    collectNodes(r, inputs);
+
+    auto lBefore = flatten(l);
+    auto rBefore = flatten(r);
+
+    auto c = concat(l, r);
+
+    std::set<Tree const*> result;
+    collectNodes(c, result);
+    auto fresh = std::count_if(result.begin(), result.end(), [&](auto p) {
+        return inputs.count(p) == 0;
+    });
+    ASSERT_LE(fresh, 40);
+
+    ASSERT_EQ(lBefore, flatten(l));
+    ASSERT_EQ(rBefore, flatten(r));
+}
+
+TEST(TreeTest, index) {
+    using Tree = Tree<int, int>;
+    auto t     = build<Tree>(0, 500);
+    for (int i = 0; i < 500; ++i) {
+        ASSERT_EQ(i, fringetree::index(t, i));
+    }
+    ASSERT_THROW(fringetree::index(t, 500), std::out_of_range);
+    ASSERT_THROW(fringetree::index(t, -1), std::out_of_range);
+    ASSERT_THROW(fringetree::index(Tree::empty(), 0), std::out_of_range);
+
+    auto t2 = Tree::branch(
+        Tree::branch(Tree::empty(), Tree::leaf(1)),
+        Tree::branch(Tree::leaf(2), Tree::empty())
+        );
+    ASSERT_EQ(1, fringetree::index(t2, 0));
+    ASSERT_EQ(2, fringetree::index(t2, 1));
+}
+
+TEST(TreeTest, splitAt) {
+    using Tree = Tree<int, int>;
+    auto t     = build<Tree>(0, 300);
+    auto all   = flatten(t);
+    for (int i = 0; i <= 301; ++i) {
+        auto [l, r] = split_at(t, i);
+        auto cut    = std::clamp(i, 0, 300);
+        ASSERT_EQ(std::vector<int>(all.begin(), all.begin() + cut),
+                  flatten(l));
+        ASSERT_EQ(std::vector<int>(all.begin() + cut, all.end()),
+                  flatten(r));
+        ASSERT_TRUE(isBalanced(l));
+        ASSERT_TRUE(isBalanced(r));
+    }
+    ASSERT_EQ(all, flatten(t));
+}
+
+TEST(TreeTest, slice) {
+    using Tree = Tree<int, int>;
+    auto t     = build<Tree>(0, 100);
+    auto s     = slice(t, 10, 20);
+    std::vector<int> expected(10);
+    std::iota(expected.begin(), expected.end(), 10);
+    ASSERT_EQ(expected, flatten(s));
+    ASSERT_EQ(std::vector<int>{}, flatten(slice(t, 50, 50)));
+    ASSERT_EQ(flatten(t), flatten(slice(t, 0, 100)));
+}
+
+TEST(TreeTest, splitShares) {
+    using Tree = Tree<int, int>;
+    auto t = build<Tree>(0, 10000);
+
+    std::set<Tree const*> input;
+    collectNodes(t, input);
+
+    auto [l, r] = split_at(t, 4321);
+    std::set<Tree const*> result;
+    collectNodes(l, result);
+    collectNodes(r, result);
+    auto fresh = std::count_if(result.begin(), result.end(), [&](auto p) {
+        return input.count(p) == 0;
+    });
+    ASSERT_LE(fresh, 100);
+}
+
+namespace {
+struct SumMeasure {
+    static auto identity() -> long { return 0; }
+    static auto leaf(int v) -> long { return v; }
+    static auto combine(long l, long r) -> long { return l + r; }
+};
+
+struct MaxMeasure {
+    static auto identity() -> int { return std::numeric_limits<int>::min(); }
+    static auto leaf(int v) -> int { return v; }
+    static auto combine(int l, int r) -> int { return std::max(l, r); }
+};
+} // namespace
+
+TEST(TreeTest, measurePolicy) {
+    using Tree = Tree<long, int, SumMeasure>;
+    auto t     = build<Tree>(1, 101);
+    ASSERT_EQ(5050, measure(t));
+    ASSERT_EQ(100u, t->size());
+    ASSERT_EQ(0, measure(Tree::empty()));
+    ASSERT_EQ(5050 - 1, measure(tail(t)));
+    ASSERT_EQ(5050 + 1, measure(concat(Tree::leaf(1), t)));
+    ASSERT_TRUE(isBalanced(t));
+    ASSERT_EQ(42, fringetree::index(t, 41));
+
+    using MaxTree = fringetree::Tree<int, int, MaxMeasure>;
+    auto mt       = MaxTree::empty();
+    for (int v : {3, 9, -2, 14, 7}) {
+        mt = append(v, mt);
+    }
+    ASSERT_EQ(14, measure(mt));
+    ASSERT_EQ(9, measure(split_at(mt, 3).first));
+    ASSERT_EQ(std::numeric_limits<int>::min(), measure(MaxTree::empty()));
+}
+
+TEST(TreeTest, split) {
+    using Tree = Tree<long, int, SumMeasure>;
+    auto t     = build<Tree>(1, 101);
+
+    auto [l, r] = split(t, [](long sum) { return sum > 100; });
+    ASSERT_EQ(std::vector<int>({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13}),
+              flatten(l));
+    ASSERT_EQ(14, head(r));
+    ASSERT_TRUE(isBalanced(l));
+    ASSERT_TRUE(isBalanced(r));
+
+    auto [all, none] = split(t, [](long sum) { return sum > 10000; });
+    ASSERT_EQ(t, all);
+    ASSERT_TRUE(none->isEmpty());
+
+    auto [none2, all2] = split(t, [](long) { return true; });
+    ASSERT_TRUE(none2->isEmpty());
+    ASSERT_EQ(t, all2);
+
+    using SizeTree = fringetree::Tree<int, int>;
+    auto s         = build<SizeTree>(0, 50);
+    for (int i = 0; i < 50; ++i) {
+        auto bySize = split(s, [i](int n) { return n > i; });
+        ASSERT_EQ(flatten(split_at(s, i).first), flatten(bySize.first));
+        ASSERT_EQ(i, head(bySize.second));
+    }
+}
+
+TEST(TreeTest, iterator) {
+    using Tree = Tree<int, int>;
+    auto t     = build<Tree>(0, 1000);
+
+    std::vector<int> forward(t->begin(), t->end());
+    ASSERT_EQ(flatten(t), forward);
+
+    std::vector<int> backward;
+    for (auto it = t->end(); it != t->begin();) {
+        backward.push_back(*--it);
+    }
+    std::reverse(backward.begin(), backward.end());
+    ASSERT_EQ(forward, backward);
+
+    auto found = std::find(t->begin(), t->end(), 500);
+    ASSERT_NE(found, t->end());
+    ASSERT_EQ(500, *found);
+    ASSERT_EQ(&*found, &*std::next(t->begin(), 500));
+    ASSERT_EQ(499, *std::prev(found));
+
+    auto empty = Tree::empty();
+    ASSERT_EQ(empty->begin(), empty->end());
+
+    auto t2 = Tree::branch(
+        Tree::branch(Tree::empty(), Tree::leaf(1)),
+        Tree::branch(Tree::leaf(2), Tree::empty())
+        );
+    ASSERT_EQ(std::vector<int>({1, 2}),
+              std::vector<int>(t2->begin(), t2->end()));
+
+    auto leaf = Tree::leaf(7);
+    auto dup  = Tree::branch(leaf, leaf);
+    int  sum  = 0;
+    for (int v : *dup) {
+        sum += v;
+    }
+    ASSERT_EQ(14, sum);
+    ASSERT_EQ(2, std::distance(dup->begin(), dup->end()));
+
+#if defined(__cpp_lib_ranges)
+    static_assert(std::ranges::bidirectional_range<Tree>);
+    ASSERT_EQ(999, std::ranges::max(*t));
+#endif
+}
+
+// A path deeper than the iterator keeps inline spills to the heap, and
+// copies taken there step on independently.
+TEST(TreeTest, deepIterator) {
+    using Tree = Tree<int, int>;
+    auto t     = Tree::leaf(0);
+    for (int i = 1; i < 300; ++i) {
+        t = Tree::branch(t, Tree::leaf(i));
+    }
+
+    std::vector<int> expected(300);
+    std::iota(expected.begin(), expected.end(), 0);
+    ASSERT_EQ(expected, std::vector<int>(t->begin(), t->end()));
+
+    std::vector<int> backward;
+    for (auto it = t->end(); it != t->begin();) {
+        backward.push_back(*--it);
+    }
+    ASSERT_EQ(expected, std::vector<int>(backward.rbegin(), backward.rend()));
+
+    auto it   = t->begin();
+    auto copy = it++;
+    ASSERT_EQ(0, *copy);
+    ASSERT_EQ(1, *it);
+    ASSERT_EQ(2, *++it);
+    ASSERT_EQ(1, *++copy);
+    copy = it;
+    ASSERT_EQ(it, copy);
+    ASSERT_EQ(3, *++copy);
+}
+
+TEST(TreeTest, sameFringe) {
+    using Tree = Tree<int, int>;
+    auto t     = Tree::branch(
+        Tree::branch(Tree::leaf(1), Tree::leaf(2)),
+        Tree::leaf(3)
+        );
+    auto u = Tree::branch(
+        Tree::leaf(1),
+        Tree::branch(Tree::leaf(2), Tree::leaf(3))
+        );
+    auto v = Tree::branch(
+        Tree::branch(Tree::empty(), Tree::leaf(1)),
+        Tree::branch(Tree::leaf(2),
+                     Tree::branch(Tree::leaf(3), Tree::empty()))
+        );
+
+    ASSERT_TRUE(same_fringe(t, u));
+    ASSERT_TRUE(same_fringe(t, v));
+    ASSERT_TRUE(same_fringe(u, v));
+    ASSERT_TRUE(same_fringe(Tree::empty(), Tree::empty()));
+    ASSERT_FALSE(same_fringe(t, Tree::empty()));
+    ASSERT_FALSE(same_fringe(t, append(4, u)));
+    ASSERT_FALSE(same_fringe(t, prepend(0, tail(u))));
+
+    auto big  = build<Tree>(0, 5000);
+    auto big2 = concat(build<Tree>(0, 2500), build<Tree>(2500, 5000));
+    ASSERT_TRUE(same_fringe(big, big2));
+    ASSERT_TRUE(same_fringe(big, big));
+    ASSERT_FALSE(same_fringe(big, concat(init(big), Tree::leaf(-1))));
+}
+
+TEST(TreeTest, compareFringe) {
+    using Tree = Tree<int, int>;
+    auto a     = build<Tree>(0, 100);
+    auto b     = build<Tree>(0, 100);
+    ASSERT_EQ(0, compare_fringe(a, b));
+    ASSERT_EQ(0, compare_fringe(a, a));
+    ASSERT_EQ(-1, compare_fringe(init(a), b));
+    ASSERT_EQ(1, compare_fringe(a, init(b)));
+    ASSERT_EQ(1, compare_fringe(concat(init(a), Tree::leaf(100)), b));
+    ASSERT_EQ(-1, compare_fringe(Tree::empty(), a));
+    ASSERT_EQ(0, compare_fringe(Tree::empty(), Tree::empty()));
+    ASSERT_EQ(1, compare_fringe(prepend(1, a), prepend(0, a)));
+}
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+TEST(TreeTest, fringeGenerator) {
+    using Tree = Tree<int, int>;
+    auto t     = build<Tree>(0, 100);
+
+    std::vector<int> seen;
+    for (auto const& v : fringe(t)) {
+        seen.push_back(v);
+        if (v == 9) {
+            break;
+        }
+    }
+    ASSERT_EQ(std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), seen);
+
+    std::vector<int> all;
+    for (auto const& v : fringe(t)) {
+        all.push_back(v);
+    }
+    ASSERT_EQ(flatten(t), all);
+}
+#endif
+
+TEST(TreeTest, flattenInto) {
+    using Tree = Tree<int, int>;
+    auto t     = build<Tree>(0, 1000);
+
+    std::vector<int> out(1002, -1);
+    auto             end = flatten_into(t, out.begin() + 1);
+    ASSERT_EQ(out.begin() + 1001, end);
+    ASSERT_EQ(-1, out.front());
+    ASSERT_EQ(-1, out.back());
+    ASSERT_TRUE(std::equal(out.begin() + 1, end, t->begin()));
+
+    std::vector<int> appended = {-2};
+    flatten_into(tail(t), std::back_inserter(appended));
+    ASSERT_EQ(1000u, appended.size());
+    ASSERT_EQ(1, appended[1]);
+
+    auto flat = flatten(t);
+    ASSERT_EQ(1000u, flat.size());
+    ASSERT_EQ(1000u, flat.capacity());
+
+    std::vector<int> none;
+    flatten_into(Tree::empty(), std::back_inserter(none));
+    ASSERT_TRUE(none.empty());
+}
+
+TEST(TreeTest, sharedEmpty) {
+    using Tree = Tree<int, int>;
+    ASSERT_EQ(Tree::empty(), Tree::empty());
+    ASSERT_EQ(Tree::empty(), tail(Tree::leaf(1)));
+    ASSERT_EQ(Tree::empty(), init(Tree::leaf(1)));
+    ASSERT_EQ(Tree::empty(), split_at(Tree::leaf(1), 1).second);
+
+    auto leaf = Tree::leaf(1);
+    ASSERT_EQ(leaf, Tree::branch(Tree::empty(), leaf));
+    ASSERT_EQ(leaf, Tree::branch(leaf, Tree::empty()));
+    ASSERT_EQ(Tree::empty(), Tree::branch(Tree::empty(), Tree::empty()));
+}
+
+TEST(TreeTest, noEmptyChildren) {
+    using Tree = Tree<int, int>;
+    auto t     = build<Tree>(0, 300);
+    for (std::size_t i = 1; i < 300; i += 7) {
+        auto [l, r] = split_at(t, i);
+        for (auto const& part : {l, r, concat(r, l), tail(l), init(r)}) {
+            std::set<Tree const*> nodes;
+            collectNodes(part, nodes);
+            if (part->isEmpty()) {
+                continue;
+            }
+            for (auto const* n : nodes) {
+                ASSERT_FALSE(n->isEmpty());
+            }
+        }
+    }
+}
+
+TEST(TreeTest, fromRange) {
+    using Tree = Tree<int, int>;
+    ASSERT_EQ(Tree::empty(), Tree::from_range({}));
+
+    for (int n = 1; n < 300; ++n) {
+        std::vector<int> values(n);
+        std::iota(values.begin(), values.end(), 0);
+        auto t = Tree::from_range(values.begin(), values.end());
+        ASSERT_EQ(values, flatten(t));
+
+        std::size_t height = 1;
+        while ((std::size_t{1} << (height - 1)) < std::size_t(n)) {
+            ++height;
+        }
+        ASSERT_EQ(height, depth(t));
+        ASSERT_TRUE(isBalanced(t));
+        ASSERT_TRUE(isBalanced(append(n, t)));
+    }
+
+    auto t = Tree::from_range({1, 2, 3, 4, 5});
+    ASSERT_EQ(std::vector<int>({1, 2, 3, 4, 5}), flatten(t));
+
+    std::istringstream in("1 2 3 4");
+    auto               s = Tree::from_range(std::istream_iterator<int>(in),
+                                            std::istream_iterator<int>());
+    ASSERT_EQ(std::vector<int>({1, 2, 3, 4}), flatten(s));
+}
+
+TEST(TreeTest, fromRangeMoves) {
+    using Tree = Tree<int, std::string>;
+    std::vector<std::string> values;
+    for (int i = 0; i < 10; ++i) {
+        values.push_back(std::string(100, char('a' + i)));
+    }
+    auto copied = Tree::from_range(values.begin(), values.end());
+    ASSERT_EQ(std::string(100, 'a'), values.front());
+
+    std::vector<char const*> buffers;
+    for (auto const& v : values) {
+        buffers.push_back(v.data());
+    }
+    auto moved = Tree::from_range(std::make_move_iterator(values.begin()),
+                                  std::make_move_iterator(values.end()));
+    ASSERT_TRUE(same_fringe(copied, moved));
+    auto it = moved->begin();
+    for (auto const* buffer : buffers) {
+        ASSERT_EQ(buffer, (it++)->data());
+    }
+}
+
+namespace {
+struct Counted {
+    static int copies;
+
+    int v_;
+
+    explicit Counted(int v) : v_(v) {}
+    Counted(Counted const& other) : v_(other.v_) { ++copies; }
+    Counted(Counted&&) = default;
+};
+
+int Counted::copies = 0;
+} // namespace
+
+TEST(TreeTest, noCopies) {
+    using Tree      = Tree<int, Counted>;
+    Counted::copies = 0;
+
+    auto t = Tree::leaf_emplace(0);
+    for (int i = 1; i < 100; ++i) {
+        t = append(Counted(i), t);
+        t = prepend(Counted(-i), t);
+    }
+    ASSERT_EQ(-99, head(t).v_);
+    ASSERT_EQ(99, last(t).v_);
+    ASSERT_EQ(0, fringetree::index(t, 99).v_);
+    ASSERT_EQ(&head(t), &*t->begin());
+
+    auto l = view_l(t);
+    ASSERT_EQ(-99, l.value().v_);
+    ASSERT_EQ(-98, head(l.tree()).v_);
+    ASSERT_EQ(98, last(init(tail(t))).v_);
+
+    auto [left, right] = split_at(t, 50);
+    ASSERT_EQ(-49, head(right).v_);
+    ASSERT_EQ(199u, concat(right, left)->size());
+    ASSERT_EQ(0, Counted::copies);
+
+    Counted c(7);
+    t = append(c, t);
+    ASSERT_EQ(1, Counted::copies);
+
+    auto flat = flatten(t);
+    ASSERT_EQ(1 + 200, Counted::copies);
+    ASSERT_THROW(head(Tree::empty()), std::out_of_range);
+    ASSERT_THROW(last(Tree::empty()), std::out_of_range);
+}
+
+TEST(TreeTest, deepTrees) {
+    using Tree         = Tree<int, int>;
+    constexpr int size = 50000;
+
+    auto leftSpine  = Tree::empty();
+    auto rightSpine = Tree::empty();
+    for (int i = 0; i < size; ++i) {
+        leftSpine  = Tree::branch(leftSpine, Tree::leaf(i));
+        rightSpine = Tree::branch(Tree::leaf(size - 1 - i), rightSpine);
+    }
+
+    for (auto const& t : {leftSpine, rightSpine}) {
+        ASSERT_EQ(std::size_t(size), depth(t));
+        ASSERT_EQ(std::size_t(size), breadth(t));
+        ASSERT_EQ(0, head(t));
+        ASSERT_EQ(size - 1, last(t));
+        ASSERT_EQ(1, head(tail(t)));
+        ASSERT_EQ(size - 2, last(init(t)));
+        ASSERT_EQ(-1, head(prepend(-1, t)));
+        ASSERT_EQ(size, last(append(size, t)));
+        ASSERT_EQ(std::size_t(size), flatten(t).size());
+
+        Transient<Tree> transient(t);
+        transient.push_front(-1);
+        transient.push_back(size);
+        auto pushed = transient.persistent();
+        ASSERT_EQ(-1, head(pushed));
+        ASSERT_EQ(size, last(pushed));
+        ASSERT_EQ(std::size_t(size + 2), pushed->size());
+
+        auto [l, r] = split_at(t, size / 2);
+        ASSERT_EQ(size / 2 - 1, last(l));
+        ASSERT_EQ(size / 2, head(r));
+
+        ASSERT_TRUE(same_fringe(t, concat(l, r)));
+
+        auto joined = concat(concat(Tree::leaf(-1), t), Tree::leaf(size));
+        ASSERT_EQ(std::size_t(size + 2), joined->size());
+    }
+    ASSERT_TRUE(same_fringe(leftSpine, rightSpine));
+
+    std::ostringstream out;
+    printer(out, leftSpine);
+    ASSERT_FALSE(out.str().empty());
+
+    leftSpine.reset();
+    rightSpine.reset();
+}
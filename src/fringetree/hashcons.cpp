@@ -0,0 +1,2 @@
+// hashcons.cpp                                                       -*-C++-*-
+#include <fringetree/hashcons.h>
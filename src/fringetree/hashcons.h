@@ -0,0 +1,216 @@
+// hashcons.h                                                         -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_HASHCONS
+#define INCLUDED_FRINGETREE_HASHCONS
+
+#include <fringetree/fringetree.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fringetree {
+
+// A factory that hash-conses nodes: a leaf or branch equal to one it has
+// already built and still holds is returned instead of a new node.  Leaves
+// are equal when their values are.  Branches are equal when their children
+// are the same nodes, so trees built entirely through one factory are equal
+// exactly when their roots are the same pointer.  Children built elsewhere
+// are accepted but only match themselves; 'intern' rebuilds a whole tree
+// through the factory.
+//
+// The table is split into shards, each with its own mutex, and is safe to
+// use from several threads as long as 'Tree's ownership policy is.  Each
+// entry keeps the node's structural hash next to a counted reference to it.
+// A weak reference is not enough: transients and teardown rewrite a node in
+// place when they hold its only reference, which must never happen to a node
+// the table can still hand out.  Instead, a node is dropped from the table
+// once the table's reference is its only one, when a shard's sweep finds it.
+// Shards sweep themselves whenever they have doubled since the last sweep,
+// and 'collect' sweeps them all.
+template <typename Tree,
+          typename Hash  = std::hash<typename Tree::Value_>,
+          typename Equal = std::equal_to<typename Tree::Value_>>
+class HashCons {
+    using Ptr_   = typename Tree::Ptr_;
+    using Value_ = typename Tree::Value_;
+
+    static constexpr std::size_t shards_  = 16;
+    static constexpr std::size_t minimum_ = 1024;
+
+    struct Shard {
+        std::mutex                                 mutex_;
+        std::unordered_multimap<std::size_t, Ptr_> nodes_;
+        std::size_t                                limit_ = minimum_;
+    };
+
+    std::array<Shard, shards_> table_;
+    Hash                       hash_;
+    Equal                      equal_;
+
+    static auto mix(std::size_t seed, std::size_t h) -> std::size_t {
+        return seed ^ (h + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+    }
+
+    auto shard(std::size_t h) -> Shard& {
+        return table_[(h ^ (h >> 16)) % shards_];
+    }
+
+    // Drops every node only the table refers to.  Freeing a branch can leave
+    // its children unreferenced in turn, so passes repeat until one frees
+    // nothing.
+    static auto sweep(Shard& shard) -> bool {
+        bool any = false;
+        for (bool freed = true; freed;) {
+            freed = false;
+            for (auto it = shard.nodes_.begin(); it != shard.nodes_.end();) {
+                if (it->second.use_count() == 1) {
+                    it    = shard.nodes_.erase(it);
+                    freed = any = true;
+                } else {
+                    ++it;
+                }
+            }
+        }
+        shard.limit_ = std::max(minimum_, 2 * shard.nodes_.size());
+        return any;
+    }
+
+    // Returns the node in the table with hash 'h' that 'matches', or the one
+    // 'make' builds, which is then added.
+    template <typename Matches, typename Make>
+    auto find(std::size_t h, Matches matches, Make make) -> Ptr_ {
+        auto&                       s = shard(h);
+        std::lock_guard<std::mutex> lock(s.mutex_);
+        auto [first, last] = s.nodes_.equal_range(h);
+        for (; first != last; ++first) {
+            if (matches(*first->second)) {
+                return first->second;
+            }
+        }
+        if (s.nodes_.size() >= s.limit_) {
+            sweep(s);
+        }
+        return s.nodes_.emplace(h, make())->second;
+    }
+
+    auto hashOf(Tree const& node) const -> std::size_t {
+        if (auto const* l = node.asLeaf()) {
+            return mix(1, hash_(l->value()));
+        }
+        auto const* b = node.asBranch();
+        return mix(mix(2, std::hash<Tree const*>()(b->left().get())),
+                   std::hash<Tree const*>()(b->right().get()));
+    }
+
+  public:
+    explicit HashCons(Hash hash = Hash(), Equal equal = Equal())
+        : hash_(std::move(hash)), equal_(std::move(equal)) {}
+
+    HashCons(HashCons const&)                    = delete;
+    auto operator=(HashCons const&) -> HashCons& = delete;
+
+    auto leaf(Value_ const& v) -> Ptr_ {
+        return find(
+            mix(1, hash_(v)),
+            [&](Tree const& node) {
+                auto const* l = node.asLeaf();
+                return l != nullptr && equal_(l->value(), v);
+            },
+            [&] { return Tree::leaf(v); });
+    }
+
+    // Like 'Tree::branch', joining with an empty tree returns the other.
+    auto branch(Ptr_ left, Ptr_ right) -> Ptr_ {
+        if (left->isEmpty()) {
+            return right;
+        }
+        if (right->isEmpty()) {
+            return left;
+        }
+        auto h = mix(mix(2, std::hash<Tree const*>()(left.get())),
+                     std::hash<Tree const*>()(right.get()));
+        return find(
+            h,
+            [&](Tree const& node) {
+                auto const* b = node.asBranch();
+                return b != nullptr && b->left() == left &&
+                       b->right() == right;
+            },
+            [&] { return Tree::branch(left, right); });
+    }
+
+    // Returns the factory's copy of 'tree', building whatever part of it the
+    // factory does not already hold.  The shape is kept as it is.
+    auto intern(Ptr_ const& tree) -> Ptr_ {
+        struct Frame {
+            Tree const* node_;
+            bool        built_;
+        };
+        std::vector<Frame> stack{{tree.get(), false}};
+        std::vector<Ptr_>  built;
+        while (!stack.empty()) {
+            auto frame = stack.back();
+            stack.pop_back();
+            if (auto const* b = frame.node_->asBranch()) {
+                if (frame.built_) {
+                    auto right = std::move(built.back());
+                    built.pop_back();
+                    built.back() = branch(std::move(built.back()),
+                                          std::move(right));
+                } else {
+                    stack.push_back({frame.node_, true});
+                    stack.push_back({b->right().get(), false});
+                    stack.push_back({b->left().get(), false});
+                }
+            } else if (auto const* l = frame.node_->asLeaf()) {
+                built.push_back(leaf(l->value()));
+            } else {
+                built.push_back(Tree::empty());
+            }
+        }
+        return built.back();
+    }
+
+    // True if 'tree' is a node this factory holds.
+    auto contains(Ptr_ const& tree) -> bool {
+        if (tree->isEmpty()) {
+            return true;
+        }
+        auto&                       s = shard(hashOf(*tree));
+        std::lock_guard<std::mutex> lock(s.mutex_);
+        auto [first, last] = s.nodes_.equal_range(hashOf(*tree));
+        return std::any_of(first, last, [&](auto const& entry) {
+            return entry.second == tree;
+        });
+    }
+
+    // Drops every node no longer referenced outside the table.
+    void collect() {
+        for (bool freed = true; freed;) {
+            freed = false;
+            for (auto& s : table_) {
+                std::lock_guard<std::mutex> lock(s.mutex_);
+                freed = sweep(s) || freed;
+            }
+        }
+    }
+
+    // The number of nodes held, including any not yet collected.
+    auto size() -> std::size_t {
+        std::size_t n = 0;
+        for (auto& s : table_) {
+            std::lock_guard<std::mutex> lock(s.mutex_);
+            n += s.nodes_.size();
+        }
+        return n;
+    }
+};
+
+} // namespace fringetree
+
+#endif
@@ -0,0 +1,126 @@
+#include <fringetree/hashcons.h>
+#include <fringetree/intrusive.h>
+#include <fringetree/transient.h>
+#include <fringetree/testsupport.t.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace fringetree;
+using namespace fringetree::test;
+
+TEST(HashConsTest, sharesEqualNodes) {
+    using Tree = Tree<int, int>;
+    HashCons<Tree> nodes;
+
+    auto left  = nodes.branch(nodes.branch(nodes.leaf(1), nodes.leaf(2)),
+                             nodes.leaf(3));
+    auto right = nodes.branch(nodes.branch(nodes.leaf(1), nodes.leaf(2)),
+                              nodes.leaf(3));
+    ASSERT_EQ(left, right);
+    ASSERT_EQ(5u, nodes.size());
+
+    auto other = nodes.branch(nodes.leaf(1),
+                              nodes.branch(nodes.leaf(2), nodes.leaf(3)));
+    ASSERT_NE(left, other);
+    ASSERT_TRUE(same_fringe(left, other));
+
+    ASSERT_EQ(nodes.leaf(4), nodes.branch(Tree::empty(), nodes.leaf(4)));
+}
+
+TEST(HashConsTest, intern) {
+    using Tree = Tree<int, int>;
+    HashCons<Tree> nodes;
+
+    auto v = values(1000);
+    auto a = Tree::from_range(v.begin(), v.end());
+    auto b = Tree::from_range(v.begin(), v.end());
+    ASSERT_NE(a, b);
+
+    auto ia = nodes.intern(a);
+    auto ib = nodes.intern(b);
+    ASSERT_EQ(ia, ib);
+    ASSERT_EQ(ia, nodes.intern(ia));
+    ASSERT_EQ(flatten(a), flatten(ia));
+    ASSERT_EQ(depth(a), depth(ia));
+    ASSERT_TRUE(nodes.contains(ia));
+    ASSERT_FALSE(nodes.contains(a));
+
+    // Repeated values collapse to one leaf each.
+    auto repeated = nodes.intern(Tree::from_range({7, 7, 7, 7}));
+    ASSERT_EQ(repeated->asBranch()->left(), repeated->asBranch()->right());
+}
+
+TEST(HashConsTest, collect) {
+    using Tree = Tree<int, int>;
+    HashCons<Tree> nodes;
+
+    auto v    = values(500);
+    auto kept = nodes.intern(Tree::from_range(v.begin(), v.begin() + 100));
+    auto size = nodes.size();
+    {
+        auto dropped = nodes.intern(Tree::from_range(v.begin(), v.end()));
+        ASSERT_GT(nodes.size(), size);
+    }
+    nodes.collect();
+    ASSERT_EQ(size, nodes.size());
+    ASSERT_TRUE(nodes.contains(kept));
+
+    kept = Tree::empty();
+    nodes.collect();
+    ASSERT_EQ(0u, nodes.size());
+}
+
+TEST(HashConsTest, transientsCopyInternedNodes) {
+    using Tree = Tree<int, int>;
+    HashCons<Tree> nodes;
+
+    auto v = values(64);
+    auto t = nodes.intern(Tree::from_range(v.begin(), v.end()));
+    {
+        Transient<Tree> transient(std::move(t));
+        transient.push_back(64);
+        transient.push_front(-1);
+    }
+    auto again = nodes.intern(Tree::from_range(v.begin(), v.end()));
+    ASSERT_EQ(v, flatten(again));
+}
+
+TEST(HashConsTest, concurrent) {
+    using Tree = Tree<int, int>;
+    HashCons<Tree> nodes;
+
+    auto                   v = values(2000);
+    std::vector<Ptr<Tree>> roots(4);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < roots.size(); ++i) {
+        threads.emplace_back([&, i] {
+            for (int round = 0; round < 5; ++round) {
+                roots[i] =
+                    nodes.intern(Tree::from_range(v.begin(), v.end()));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto const& root : roots) {
+        ASSERT_EQ(roots[0], root);
+    }
+    ASSERT_EQ(v, flatten(roots[0]));
+}
+
+TEST(HashConsTest, intrusiveOwnership) {
+    using Tree =
+        Tree<int, int, SizeMeasure<int>, std::allocator<int>, LocalOwnership>;
+    HashCons<Tree> nodes;
+
+    auto a = nodes.intern(Tree::from_range({1, 2, 3, 4}));
+    auto b = nodes.intern(Tree::from_range({1, 2, 3, 4}));
+    ASSERT_EQ(a, b);
+    a = b = Tree::empty();
+    nodes.collect();
+    ASSERT_EQ(0u, nodes.size());
+}
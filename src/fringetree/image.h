@@ -0,0 +1,358 @@
+// image.h                                                            -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_IMAGE
+#define INCLUDED_FRINGETREE_IMAGE
+
+#include <fringetree/fringetree.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace fringetree {
+
+// A tree image is a flat binary form of a tree: a header followed by one
+// fixed-size record per distinct node, children before their parents and the
+// root last.  A subtree shared within the tree is written once.  Records
+// hold tags and values as their bytes in memory, so an image is read back
+// only by a build with the same 'Tag' and 'Value' layout and byte order; the
+// header records enough to check that.  Each branch refers to its children
+// by how many records back they are, so a record is usable in place
+// wherever the image is loaded, including straight from a mapped file.
+
+struct ImageHeader {
+    static constexpr char          magic[8] = {'F', 'R', 'I', 'N',
+                                               'G', 'E', 'T', 'R'};
+    static constexpr std::uint32_t version  = 1;
+    static constexpr std::uint32_t order    = 0x01020304;
+
+    char          magic_[8];
+    std::uint32_t version_;
+    std::uint32_t order_;
+    std::uint32_t recordSize_;
+    std::uint32_t tagSize_;
+    std::uint32_t valueSize_;
+    std::uint32_t reserved_;
+    std::uint64_t count_;
+    std::uint64_t reserved2_[3];
+};
+
+static_assert(sizeof(ImageHeader) == 64);
+
+template <typename Tag, typename Value>
+class ImageNode;
+
+// A pointer to a node of an image, shaped like a tree pointer.
+template <typename Node>
+class ImageRef {
+    Node const* p_;
+
+  public:
+    using element_type = Node;
+
+    ImageRef() : p_(nullptr) {}
+    explicit ImageRef(Node const* p) : p_(p) {}
+
+    auto get() const -> Node const* { return p_; }
+    auto operator*() const -> Node const& { return *p_; }
+    auto operator->() const -> Node const* { return p_; }
+    explicit operator bool() const { return p_ != nullptr; }
+
+    friend bool operator==(ImageRef lhs, ImageRef rhs) {
+        return lhs.p_ == rhs.p_;
+    }
+
+    friend bool operator!=(ImageRef lhs, ImageRef rhs) {
+        return lhs.p_ != rhs.p_;
+    }
+};
+
+// What 'ImageNode::visit' hands its visitor, one for each kind of node.
+template <typename Node>
+struct ImageEmpty {
+    Node const& node_;
+    auto tag() const { return node_.tag(); }
+    auto size() const -> std::size_t { return 0; }
+};
+
+template <typename Node>
+struct ImageLeaf {
+    Node const& node_;
+    auto tag() const { return node_.tag(); }
+    auto size() const -> std::size_t { return 1; }
+    auto value() const -> decltype(auto) { return node_.value(); }
+};
+
+template <typename Node>
+struct ImageBranch {
+    Node const& node_;
+    auto tag() const { return node_.tag(); }
+    auto size() const -> std::size_t { return node_.size(); }
+    auto left() const { return node_.left(); }
+    auto right() const { return node_.right(); }
+};
+
+// One record of an image.  It answers the same questions a 'Tree' node does,
+// so 'LeafIterator', 'index', 'tag' and 'measure' work over an image as they
+// do over a tree.  A branch always has two leaves or more, so the leaf count
+// also tells the kinds apart.
+template <typename Tag, typename Value>
+class ImageNode {
+    static_assert(std::is_trivially_copyable_v<Tag> &&
+                      std::is_trivially_copyable_v<Value>,
+                  "images hold tags and values as raw bytes");
+
+    struct Children {
+        std::uint64_t left_;
+        std::uint64_t right_;
+    };
+
+    std::uint64_t size_;
+    Tag           tag_;
+    union {
+        Children children_;
+        Value    value_;
+    };
+
+    template <typename Tree>
+    friend class ImageWriter;
+
+    ImageNode(std::uint64_t size, Tag tag, Children children)
+        : size_(size), tag_(tag), children_(children) {}
+
+    ImageNode(Tag tag, Value value) : size_(1), tag_(tag), value_(value) {}
+
+  public:
+    using Tag_           = Tag;
+    using Value_         = Value;
+    using Ptr_           = ImageRef<ImageNode>;
+    using const_iterator = LeafIterator<ImageNode>;
+    using iterator       = const_iterator;
+
+    auto tag() const -> Tag { return tag_; }
+    auto size() const -> std::size_t { return size_; }
+    bool isEmpty() const { return size_ == 0; }
+
+    auto asLeaf() const -> ImageNode const* {
+        return size_ == 1 ? this : nullptr;
+    }
+
+    auto asBranch() const -> ImageNode const* {
+        return size_ > 1 ? this : nullptr;
+    }
+
+    // Only meaningful on a leaf.
+    auto value() const -> Value const& { return value_; }
+
+    // Only meaningful on a branch.
+    auto left() const -> Ptr_ { return Ptr_(this - children_.left_); }
+    auto right() const -> Ptr_ { return Ptr_(this - children_.right_); }
+
+    template <typename Callable>
+    auto visit(Callable&& c) const {
+        if (size_ == 0) {
+            return c(ImageEmpty<ImageNode>{*this});
+        }
+        if (size_ == 1) {
+            return c(ImageLeaf<ImageNode>{*this});
+        }
+        return c(ImageBranch<ImageNode>{*this});
+    }
+
+    auto begin() const -> const_iterator {
+        return const_iterator(this, false);
+    }
+
+    auto end() const -> const_iterator { return const_iterator(this, true); }
+};
+
+// Writes trees as images.  Nodes are numbered children first, without
+// recursion, and a node reached again through sharing keeps its number.
+template <typename Tree>
+class ImageWriter {
+    using Tag_   = typename Tree::Tag_;
+    using Value_ = typename Tree::Value_;
+    using Node_  = ImageNode<Tag_, Value_>;
+
+  public:
+    static void write(std::ostream& os, Tree const* root) {
+        std::unordered_map<Tree const*, std::uint64_t> numbers;
+        std::vector<Tree const*>                       order;
+        std::vector<std::pair<Tree const*, bool>>      stack{{root, false}};
+        while (!stack.empty()) {
+            auto [node, expanded] = stack.back();
+            stack.pop_back();
+            if (numbers.count(node) != 0) {
+                continue;
+            }
+            auto const* b = node->asBranch();
+            if (b != nullptr && !expanded) {
+                stack.push_back({node, true});
+                stack.push_back({b->right().get(), false});
+                stack.push_back({b->left().get(), false});
+                continue;
+            }
+            numbers.emplace(node, order.size());
+            order.push_back(node);
+        }
+
+        ImageHeader header{};
+        std::memcpy(header.magic_, ImageHeader::magic, sizeof header.magic_);
+        header.version_    = ImageHeader::version;
+        header.order_      = ImageHeader::order;
+        header.recordSize_ = sizeof(Node_);
+        header.tagSize_    = sizeof(Tag_);
+        header.valueSize_  = sizeof(Value_);
+        header.count_      = order.size();
+        os.write(reinterpret_cast<char const*>(&header), sizeof header);
+
+        for (std::uint64_t i = 0; i < order.size(); ++i) {
+            // Built over zeroed bytes, so padding is written as zeroes.
+            alignas(Node_) unsigned char bytes[sizeof(Node_)] = {};
+            auto const* node = order[i];
+            if (auto const* b = node->asBranch()) {
+                new (bytes) Node_(b->size(),
+                                  b->tag(),
+                                  {i - numbers[b->left().get()],
+                                   i - numbers[b->right().get()]});
+            } else if (auto const* l = node->asLeaf()) {
+                new (bytes) Node_(l->tag(), l->value());
+            } else {
+                new (bytes) Node_(0, node->tag(), {0, 0});
+            }
+            os.write(reinterpret_cast<char const*>(bytes), sizeof bytes);
+        }
+    }
+};
+
+constexpr auto write_image = [](std::ostream& os, auto const& tree) {
+    using Tree_ = std::remove_cv_t<std::remove_reference_t<decltype(*tree)>>;
+    ImageWriter<Tree_>::write(os, tree.get());
+};
+
+// A read-only view of an image held in memory, usually a mapped file, which
+// must outlive the view.  Loading checks the header, alignment and length
+// in constant time; 'verify' also checks every record.
+template <typename Tag, typename Value>
+class Image {
+  public:
+    using Node_ = ImageNode<Tag, Value>;
+    using Ptr_  = ImageRef<Node_>;
+
+  private:
+    Node_ const*  records_;
+    std::uint64_t count_;
+
+    [[noreturn]] static void fail(char const* what) {
+        throw std::runtime_error(std::string("fringetree::Image: ") + what);
+    }
+
+  public:
+    Image(void const* data, std::size_t bytes) {
+        ImageHeader header;
+        if (bytes < sizeof header) {
+            fail("truncated header");
+        }
+        std::memcpy(&header, data, sizeof header);
+        if (std::memcmp(header.magic_, ImageHeader::magic,
+                        sizeof header.magic_) != 0 ||
+            header.version_ != ImageHeader::version) {
+            fail("not a tree image");
+        }
+        if (header.order_ != ImageHeader::order ||
+            header.recordSize_ != sizeof(Node_) ||
+            header.tagSize_ != sizeof(Tag) ||
+            header.valueSize_ != sizeof(Value)) {
+            fail("written with a different layout");
+        }
+        if (header.count_ == 0 ||
+            header.count_ > (bytes - sizeof header) / sizeof(Node_)) {
+            fail("truncated records");
+        }
+        auto const* first = static_cast<char const*>(data) + sizeof header;
+        if (reinterpret_cast<std::uintptr_t>(first) % alignof(Node_) != 0) {
+            fail("misaligned");
+        }
+        records_ = reinterpret_cast<Node_ const*>(first);
+        count_   = header.count_;
+    }
+
+    auto root() const -> Ptr_ { return Ptr_(records_ + count_ - 1); }
+
+    // The records in the order they were written.
+    auto records() const -> Node_ const* { return records_; }
+
+    // The number of distinct nodes in the image.
+    auto nodes() const -> std::size_t { return count_; }
+
+    // Checks that every branch refers only to earlier records and that the
+    // leaf counts add up, so that walking the image cannot leave it.
+    bool verify() const {
+        for (std::uint64_t i = 0; i < count_; ++i) {
+            auto const& node = records_[i];
+            if (node.isEmpty()) {
+                if (i + 1 != count_) {
+                    return false;
+                }
+            } else if (node.asBranch() != nullptr) {
+                auto l = node.left().get() - records_;
+                auto r = node.right().get() - records_;
+                if (l < 0 || r < 0 || std::uint64_t(l) >= i ||
+                    std::uint64_t(r) >= i ||
+                    node.size() != records_[l].size() + records_[r].size()) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+// Rebuilds an image as a persistent tree, with one node per record, so
+// subtrees shared in the image are shared in the tree.
+template <typename Tree, typename Tag, typename Value>
+auto read_image(Image<Tag, Value> const& image) -> typename Tree::Ptr_ {
+    auto const*                      first = image.records();
+    std::vector<typename Tree::Ptr_> built;
+    built.reserve(image.nodes());
+    for (std::size_t i = 0; i < image.nodes(); ++i) {
+        auto const& node = first[i];
+        if (node.asBranch() != nullptr) {
+            built.push_back(
+                Tree::branch(built[node.left().get() - first],
+                             built[node.right().get() - first]));
+        } else if (node.asLeaf() != nullptr) {
+            built.push_back(Tree::leaf(node.value()));
+        } else {
+            built.push_back(Tree::empty());
+        }
+    }
+    return built.back();
+}
+
+// A file mapped read-only into memory for as long as the object lives.
+class MappedFile {
+    void*       data_;
+    std::size_t size_;
+
+  public:
+    explicit MappedFile(std::string const& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile const&)                    = delete;
+    auto operator=(MappedFile const&) -> MappedFile& = delete;
+
+    auto data() const -> void const* { return data_; }
+    auto size() const -> std::size_t { return size_; }
+};
+
+} // namespace fringetree
+
+#endif
@@ -0,0 +1,150 @@
+#include <fringetree/image.h>
+#include <fringetree/testsupport.t.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using namespace fringetree;
+using namespace fringetree::test;
+
+namespace {
+// Image bytes copied into suitably aligned storage.
+struct Buffer {
+    std::vector<std::uint64_t> words_;
+    std::size_t                size_;
+
+    template <typename TreePtr>
+    explicit Buffer(TreePtr const& tree) {
+        std::ostringstream os;
+        write_image(os, tree);
+        auto bytes = os.str();
+        size_      = bytes.size();
+        words_.resize((size_ + 7) / 8);
+        std::memcpy(words_.data(), bytes.data(), size_);
+    }
+
+    auto data() const -> void const* { return words_.data(); }
+};
+} // namespace
+
+TEST(ImageTest, roundTrip) {
+    using Tree = Tree<int, int>;
+    auto v     = values(1000);
+    auto t     = Tree::from_range(v.begin(), v.end());
+    t          = append(1000, prepend(-1, t));
+
+    Buffer          buffer(t);
+    Image<int, int> image(buffer.data(), buffer.size_);
+    ASSERT_TRUE(image.verify());
+    ASSERT_EQ(2 * t->size() - 1, image.nodes());
+
+    auto root = image.root();
+    ASSERT_EQ(t->size(), root->size());
+    ASSERT_EQ(measure(t), measure(root));
+    ASSERT_EQ(tag(t), tag(root));
+    ASSERT_EQ(flatten(t), std::vector<int>(root->begin(), root->end()));
+    for (std::size_t i = 0; i < t->size(); i += 37) {
+        ASSERT_EQ(fringetree::index(t, i), fringetree::index(root, i));
+    }
+    ASSERT_THROW(fringetree::index(root, t->size()), std::out_of_range);
+
+    auto back = read_image<Tree>(image);
+    ASSERT_TRUE(same_fringe(t, back));
+    ASSERT_EQ(depth(t), depth(back));
+}
+
+TEST(ImageTest, sharedSubtreesWrittenOnce) {
+    using Tree  = Tree<int, int>;
+    auto v      = values(100);
+    auto shared = Tree::from_range(v.begin(), v.end());
+    auto t      = Tree::branch(shared, Tree::branch(shared, shared));
+
+    Buffer          buffer(t);
+    Image<int, int> image(buffer.data(), buffer.size_);
+    ASSERT_TRUE(image.verify());
+    ASSERT_EQ(199u + 2u, image.nodes());
+    ASSERT_EQ(300u, image.root()->size());
+
+    auto back = read_image<Tree>(image);
+    auto b    = back->asBranch();
+    ASSERT_EQ(b->left(), b->right()->asBranch()->left());
+    ASSERT_EQ(b->left(), b->right()->asBranch()->right());
+    ASSERT_TRUE(same_fringe(t, back));
+}
+
+TEST(ImageTest, emptyAndSingle) {
+    using Tree = Tree<int, double>;
+
+    Buffer             empty(Tree::empty());
+    Image<int, double> e(empty.data(), empty.size_);
+    ASSERT_TRUE(e.verify());
+    ASSERT_TRUE(e.root()->isEmpty());
+    ASSERT_EQ(e.root()->begin(), e.root()->end());
+    ASSERT_TRUE(read_image<Tree>(e)->isEmpty());
+
+    Buffer             single(Tree::leaf(2.5));
+    Image<int, double> s(single.data(), single.size_);
+    ASSERT_EQ(2.5, fringetree::index(s.root(), 0));
+    ASSERT_EQ(2.5, head(read_image<Tree>(s)));
+}
+
+TEST(ImageTest, rejectsBadImages) {
+    using Tree = Tree<int, int>;
+    Buffer buffer(Tree::from_range({1, 2, 3}));
+
+    using Bad = Image<int, double>;
+    ASSERT_THROW(Bad(buffer.data(), buffer.size_), std::runtime_error);
+    ASSERT_THROW((Image<int, int>(buffer.data(), buffer.size_ - 1)),
+                 std::runtime_error);
+    ASSERT_THROW((Image<int, int>(buffer.data(), 10)), std::runtime_error);
+
+    auto corrupt = buffer;
+    reinterpret_cast<char*>(corrupt.words_.data())[0] = 'X';
+    ASSERT_THROW((Image<int, int>(corrupt.data(), corrupt.size_)),
+                 std::runtime_error);
+}
+
+TEST(ImageTest, mappedFile) {
+    using Tree = Tree<int, int>;
+    auto v     = values(5000);
+    auto t     = Tree::from_range(v.begin(), v.end());
+
+    auto path = testing::TempDir() + "fringetree_image_test.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        write_image(out, t);
+    }
+    {
+        MappedFile      file(path);
+        Image<int, int> image(file.data(), file.size());
+        ASSERT_TRUE(image.verify());
+        ASSERT_EQ(v, std::vector<int>(image.root()->begin(),
+                                      image.root()->end()));
+        ASSERT_EQ(4321, fringetree::index(image.root(), 4321));
+    }
+    std::remove(path.c_str());
+    ASSERT_THROW(MappedFile{path}, std::system_error);
+}
+
+TEST(ImageTest, deepTrees) {
+    using Tree = Tree<int, int>;
+    auto spine = Tree::empty();
+    for (int i = 0; i < 20000; ++i) {
+        spine = Tree::branch(spine, Tree::leaf(i));
+    }
+    Buffer          buffer(spine);
+    Image<int, int> image(buffer.data(), buffer.size_);
+    ASSERT_TRUE(image.verify());
+    ASSERT_EQ(flatten(spine), std::vector<int>(image.root()->begin(),
+                                               image.root()->end()));
+    ASSERT_TRUE(same_fringe(spine, read_image<Tree>(image)));
+}
@@ -0,0 +1,2 @@
+// intrusive.cpp                                                      -*-C++-*-
+#include <fringetree/intrusive.h>
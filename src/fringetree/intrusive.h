@@ -0,0 +1,185 @@
+// intrusive.h                                                        -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_INTRUSIVE
+#define INCLUDED_FRINGETREE_INTRUSIVE
+
+#include <fringetree/fringetree.h>
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace fringetree {
+
+// A pointer to a node carrying its own reference count.  The node type
+// provides 'retain()' and 'release()'; copying the pointer retains, and
+// dropping it releases.
+template <typename Node>
+class IntrusivePtr {
+    Node* p_;
+
+  public:
+    using element_type = Node;
+
+    IntrusivePtr() noexcept : p_(nullptr) {}
+    IntrusivePtr(std::nullptr_t) noexcept : p_(nullptr) {}
+
+    explicit IntrusivePtr(Node* p) noexcept : p_(p) {
+        if (p_ != nullptr) {
+            p_->retain();
+        }
+    }
+
+    IntrusivePtr(IntrusivePtr const& other) noexcept
+        : IntrusivePtr(other.p_) {}
+
+    IntrusivePtr(IntrusivePtr&& other) noexcept
+        : p_(std::exchange(other.p_, nullptr)) {}
+
+    ~IntrusivePtr() {
+        if (p_ != nullptr) {
+            p_->release();
+        }
+    }
+
+    auto operator=(IntrusivePtr other) noexcept -> IntrusivePtr& {
+        swap(other);
+        return *this;
+    }
+
+    void swap(IntrusivePtr& other) noexcept { std::swap(p_, other.p_); }
+
+    void reset() noexcept { IntrusivePtr().swap(*this); }
+
+    auto get() const noexcept -> Node* { return p_; }
+    auto operator*() const noexcept -> Node& { return *p_; }
+    auto operator->() const noexcept -> Node* { return p_; }
+    explicit operator bool() const noexcept { return p_ != nullptr; }
+
+    auto use_count() const noexcept -> long {
+        return p_ == nullptr ? 0 : static_cast<long>(p_->use_count());
+    }
+
+    friend bool operator==(IntrusivePtr const& lhs, IntrusivePtr const& rhs) {
+        return lhs.p_ == rhs.p_;
+    }
+
+    friend bool operator!=(IntrusivePtr const& lhs, IntrusivePtr const& rhs) {
+        return lhs.p_ != rhs.p_;
+    }
+};
+
+// An ownership policy that keeps the reference count in the node itself, in
+// a 'Count', which is 'std::size_t' for trees confined to one thread or
+// 'std::atomic<std::size_t>' for trees shared between threads.  Nodes need
+// no separate control block, and the allocator is kept in the node only if
+// it has state.
+//
+// A node made by 'make_static', such as the empty tree every thread shares,
+// is immortal: its count is fixed at 'immortal' and never written, so even a
+// plain 'std::size_t' count is safe to use on it from any number of threads.
+template <typename Count>
+struct IntrusiveOwnership {
+    template <typename Node>
+    using Ptr = IntrusivePtr<Node>;
+
+    template <typename Node, typename Allocator>
+    class Hook : private Allocator {
+        using NodeAllocator = typename std::allocator_traits<
+            Allocator>::template rebind_alloc<Node>;
+        using Traits = std::allocator_traits<NodeAllocator>;
+
+        static constexpr std::size_t immortal =
+            std::numeric_limits<std::size_t>::max() / 2;
+
+        mutable Count count_;
+
+        friend struct IntrusiveOwnership;
+
+        bool isImmortal() const noexcept {
+            if constexpr (std::is_integral_v<Count>) {
+                return count_ == immortal;
+            } else {
+                return count_.load(std::memory_order_relaxed) == immortal;
+            }
+        }
+
+      public:
+        Hook() : Allocator(), count_(0) {}
+        Hook(Hook const&) : Allocator(), count_(0) {}
+        auto operator=(Hook const&) -> Hook& { return *this; }
+
+        void retain() const noexcept {
+            if (isImmortal()) {
+                return;
+            }
+            if constexpr (std::is_integral_v<Count>) {
+                ++count_;
+            } else {
+                count_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void release() const noexcept {
+            if (isImmortal()) {
+                return;
+            }
+            bool last;
+            if constexpr (std::is_integral_v<Count>) {
+                last = --count_ == 0;
+            } else {
+                last = count_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+            }
+            if (last) {
+                auto* node = static_cast<Node*>(const_cast<Hook*>(this));
+                NodeAllocator alloc(static_cast<Allocator const&>(*this));
+                Traits::destroy(alloc, node);
+                Traits::deallocate(alloc, node, 1);
+            }
+        }
+
+        auto use_count() const noexcept -> std::size_t { return count_; }
+    };
+
+    template <typename Node, typename Allocator, typename... Args>
+    static auto make(Allocator const& alloc, Args&&... args) -> Ptr<Node> {
+        using NodeAllocator = typename std::allocator_traits<
+            Allocator>::template rebind_alloc<Node>;
+        using Traits = std::allocator_traits<NodeAllocator>;
+
+        NodeAllocator nodeAlloc(alloc);
+        Node*         node = Traits::allocate(nodeAlloc, 1);
+        try {
+            Traits::construct(nodeAlloc, node, std::forward<Args>(args)...);
+        } catch (...) {
+            Traits::deallocate(nodeAlloc, node, 1);
+            throw;
+        }
+        static_cast<Allocator&>(static_cast<Hook<Node, Allocator>&>(*node)) =
+            alloc;
+        return Ptr<Node>(node);
+    }
+
+    // The node is never released, so it is allocated with plain 'new' and
+    // made immortal before any pointer to it exists.
+    template <typename Node, typename... Args>
+    static auto make_static(Args&&... args) -> Ptr<Node> {
+        auto* node = new Node(std::forward<Args>(args)...);
+        if constexpr (std::is_integral_v<Count>) {
+            node->count_ = Hook<Node, typename Node::Allocator_>::immortal;
+        } else {
+            node->count_.store(Hook<Node, typename Node::Allocator_>::immortal,
+                               std::memory_order_relaxed);
+        }
+        return Ptr<Node>(node);
+    }
+};
+
+using LocalOwnership  = IntrusiveOwnership<std::size_t>;
+using AtomicOwnership = IntrusiveOwnership<std::atomic<std::size_t>>;
+
+} // namespace fringetree
+
+#endif
@@ -0,0 +1,120 @@
+#include <fringetree/intrusive.h>
+#include <fringetree/allocator.h>
+#include <fringetree/testsupport.t.h>
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <thread>
+
+using namespace fringetree;
+using namespace fringetree::test;
+
+namespace {
+template <typename Ownership>
+class IntrusiveTest : public ::testing::Test {};
+
+using Ownerships = ::testing::Types<LocalOwnership, AtomicOwnership>;
+} // namespace
+
+TYPED_TEST_SUITE(IntrusiveTest, Ownerships);
+
+TYPED_TEST(IntrusiveTest, operations) {
+    using Tree =
+        Tree<int, int, SizeMeasure<int>, std::allocator<int>, TypeParam>;
+    static_assert(sizeof(Ptr<Tree>) == sizeof(void*));
+
+    auto t = build<Tree>(0, 500);
+    t      = prepend(-1, t);
+    ASSERT_EQ(501u, t->size());
+    ASSERT_EQ(-1, head(t));
+    ASSERT_EQ(499, last(t));
+    ASSERT_EQ(250, fringetree::index(t, 251));
+
+    auto [l, r] = split_at(t, 100);
+    ASSERT_EQ(100u, l->size());
+    ASSERT_TRUE(same_fringe(t, concat(l, r)));
+
+    std::vector<int> expected(501);
+    std::iota(expected.begin(), expected.end(), -1);
+    ASSERT_EQ(expected, flatten(t));
+    ASSERT_EQ(expected, std::vector<int>(t->begin(), t->end()));
+    ASSERT_EQ(expected, flatten(concat(init(l), prepend(last(l), r))));
+}
+
+TYPED_TEST(IntrusiveTest, sharing) {
+    using Tree =
+        Tree<int, int, SizeMeasure<int>, std::allocator<int>, TypeParam>;
+    auto leaf = Tree::leaf(1);
+    ASSERT_EQ(1, leaf.use_count());
+    {
+        auto b = Tree::branch(leaf, leaf);
+        ASSERT_EQ(3, leaf.use_count());
+        ASSERT_EQ(b->asBranch()->left(), leaf);
+        auto copy = b;
+        ASSERT_EQ(2, b.use_count());
+        ASSERT_EQ(3, leaf.use_count());
+    }
+    ASSERT_EQ(1, leaf.use_count());
+}
+
+TYPED_TEST(IntrusiveTest, releasesThroughAllocator) {
+    using Tree = Tree<int,
+                      int,
+                      SizeMeasure<int>,
+                      ResourceAllocator<int>,
+                      TypeParam>;
+    CountingResource counting;
+    Ptr<Tree>        t;
+    {
+        ResourceScope scope(&counting);
+        t = build<Tree>(0, 1000);
+    }
+    ASSERT_GT(counting.allocations_, 1000);
+    auto u = tail(t);
+    ASSERT_EQ(999u, u->size());
+    t.reset();
+    u.reset();
+    ASSERT_EQ(counting.allocations_, counting.deallocations_);
+}
+
+TYPED_TEST(IntrusiveTest, sharedEmpty) {
+    using Tree = Tree<int,
+                      int,
+                      SizeMeasure<int>,
+                      ResourceAllocator<int>,
+                      TypeParam>;
+    CountingResource counting;
+    {
+        ResourceScope scope(&counting);
+        auto          e = Tree::empty();
+        ASSERT_EQ(e, Tree::empty());
+        ASSERT_EQ(e, tail(Tree::leaf(1)));
+    }
+    ASSERT_EQ(1, counting.allocations_);
+    ASSERT_EQ(counting.allocations_, counting.deallocations_);
+}
+
+// Threads that each use only their own trees still share the empty node,
+// which is immortal, so even a non-atomic count is never written.
+TYPED_TEST(IntrusiveTest, threadsShareEmpty) {
+    using Tree =
+        Tree<int, int, SizeMeasure<int>, std::allocator<int>, TypeParam>;
+    auto count = Tree::empty().use_count();
+
+    auto work = [] {
+        for (int round = 0; round < 200; ++round) {
+            auto t = build<Tree>(0, 50);
+            while (!t->isEmpty()) {
+                t = tail(t);
+            }
+        }
+    };
+    std::thread a(work);
+    std::thread b(work);
+    a.join();
+    b.join();
+
+    ASSERT_EQ(count, Tree::empty().use_count());
+    ASSERT_EQ(Tree::empty(), tail(Tree::leaf(1)));
+}
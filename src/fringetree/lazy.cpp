@@ -0,0 +1,2 @@
+// lazy.cpp                                                           -*-C++-*-
+#include <fringetree/lazy.h>
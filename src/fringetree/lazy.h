@@ -0,0 +1,123 @@
+// lazy.h                                                             -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_LAZY
+#define INCLUDED_FRINGETREE_LAZY
+
+#include <fringetree/fringetree.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace fringetree {
+
+// Lazy counterparts of 'concat', a value map and 'slice'.  Each returns a
+// suspended node in constant time.  The node does its work the first time
+// it is looked into and keeps the result.  A pipeline of them costs nothing
+// until it is read, and then only what is read: taking the 'head' of a lazy
+// map forces one path, not the whole tree.  All of them accept lazy input,
+// which they pass to 'Tree::suspend' as inputs, so that stacking them to any
+// depth never deepens the call stack.
+
+// Suspends 'concat(left, right)'.  Its tag is combined from the tags of its
+// inputs at once when both are known, and is otherwise left to be found by
+// forcing, so that a lazy input is not forced for it.
+constexpr inline struct lazy_concat {
+    template <typename TreePtr>
+    auto operator()(TreePtr const& left, TreePtr const& right) const
+        -> TreePtr {
+        using Tree_ = typename TreePtr::element_type;
+        using M     = typename Tree_::Measure_;
+        if (left->isEmpty()) {
+            return right;
+        }
+        if (right->isEmpty()) {
+            return left;
+        }
+        auto leftTag  = left->knownTag();
+        auto rightTag = right->knownTag();
+        auto tag      = leftTag && rightTag
+                          ? std::optional(M::combine(*leftTag, *rightTag))
+                          : std::nullopt;
+        return Tree_::suspend(
+            std::move(tag),
+            left->size() + right->size(),
+            [](auto const& in) { return concat_(in[0], in[1]); },
+            {left, right});
+    }
+} lazy_concat_;
+
+constexpr auto lazy_concat = [](auto left, auto right) {
+    return lazy_concat_(left, right);
+};
+
+// Suspends applying 'f' to every value.  'f' must map each value to one with
+// the same measure, as any function does under the default 'SizeMeasure', so
+// that the mapped tree has the tags of 'tree' and none has to be computed up
+// front.  Where a tag of 'tree' is not known yet, neither is the map's.
+// Forcing a branch builds a branch of two suspended maps, so the map is
+// applied only to the leaves that are reached.
+constexpr inline struct lazy_map {
+  private:
+    template <typename TreePtr, typename F>
+    static auto suspend(TreePtr const& tree, std::shared_ptr<F const> f)
+        -> TreePtr {
+        using Tree_ = typename TreePtr::element_type;
+        if (tree->isEmpty()) {
+            return tree;
+        }
+        return Tree_::suspend(
+            tree->knownTag(),
+            tree->size(),
+            [f](auto const& in) {
+                if (auto const* b = in[0]->asBranch()) {
+                    return Tree_::branch(suspend(b->left(), f),
+                                         suspend(b->right(), f));
+                }
+                return Tree_::leaf((*f)(in[0]->asLeaf()->value()));
+            },
+            {tree});
+    }
+
+  public:
+    template <typename TreePtr, typename F>
+    auto operator()(TreePtr const& tree, F f) const -> TreePtr {
+        return suspend(tree, std::make_shared<F const>(std::move(f)));
+    }
+} lazy_map_;
+
+constexpr auto lazy_map = [](auto tree, auto f) {
+    return lazy_map_(tree, std::move(f));
+};
+
+// Suspends 'slice(tree, lo, hi)', with the bounds clamped to the tree.  The
+// size of a slice is known from its bounds, but its tag is not, so asking
+// for the tag forces it.
+constexpr inline struct lazy_slice {
+    template <typename TreePtr>
+    auto operator()(TreePtr const& tree, std::size_t lo, std::size_t hi) const
+        -> TreePtr {
+        using Tree_ = typename TreePtr::element_type;
+        hi          = std::min(hi, tree->size());
+        lo          = std::min(lo, hi);
+        if (lo == 0 && hi == tree->size()) {
+            return tree;
+        }
+        return Tree_::suspend(
+            std::nullopt,
+            hi - lo,
+            [lo, hi](auto const& in) {
+                return split_at_(split_at_(in[0], hi).first, lo).second;
+            },
+            {tree});
+    }
+} lazy_slice_;
+
+constexpr auto lazy_slice = [](auto tree, auto lo, auto hi) {
+    return lazy_slice_(tree, lo, hi);
+};
+
+} // namespace fringetree
+
+#endif
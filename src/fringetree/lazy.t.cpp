@@ -0,0 +1,248 @@
+#include <fringetree/lazy.h>
+#include <fringetree/intrusive.h>
+#include <fringetree/transient.h>
+#include <fringetree/testsupport.t.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace fringetree;
+using namespace fringetree::test;
+
+TEST(LazyTest, map) {
+    using Tree = Tree<int, int>;
+    auto v     = values(1000);
+    auto t     = Tree::from_range(v.begin(), v.end());
+
+    int  calls = 0;
+    auto m     = lazy_map(t, [&calls](int i) {
+        ++calls;
+        return 2 * i;
+    });
+    ASSERT_TRUE(m->isSuspended());
+    ASSERT_EQ(1000u, m->size());
+    ASSERT_EQ(1000, m->tag());
+    ASSERT_EQ(0, calls);
+
+    // Only the leaves that are reached are mapped.
+    ASSERT_EQ(0, head(m));
+    ASSERT_EQ(1998, last(m));
+    ASSERT_EQ(1000, fringetree::index(m, 500));
+    ASSERT_EQ(3, calls);
+
+    std::vector<int> expected;
+    for (auto i : v) {
+        expected.push_back(2 * i);
+    }
+    ASSERT_EQ(expected, flatten(m));
+    ASSERT_EQ(expected, flatten(m));
+    ASSERT_EQ(1000, calls);
+    ASSERT_EQ(v, flatten(t));
+
+    ASSERT_TRUE(lazy_map(Tree::empty(), [](int i) { return i; })->isEmpty());
+}
+
+TEST(LazyTest, concat) {
+    using Tree = Tree<int, int>;
+    auto v     = values(300);
+    auto a     = Tree::from_range(v.begin(), v.begin() + 100);
+    auto b     = Tree::from_range(v.begin() + 100, v.end());
+
+    auto c = lazy_concat(a, b);
+    ASSERT_TRUE(c->isSuspended());
+    ASSERT_EQ(300u, c->size());
+    ASSERT_EQ(300, measure(c));
+    ASSERT_EQ(v, flatten(c));
+    ASSERT_TRUE(same_fringe(c, concat(a, b)));
+    ASSERT_EQ(a, lazy_concat(a, Tree::empty()));
+    ASSERT_EQ(b, lazy_concat(Tree::empty(), b));
+}
+
+TEST(LazyTest, slice) {
+    using Tree = Tree<int, int>;
+    auto v     = values(100);
+    auto t     = Tree::from_range(v.begin(), v.end());
+
+    auto s = lazy_slice(t, 10, 30);
+    ASSERT_TRUE(s->isSuspended());
+    ASSERT_EQ(20u, s->size());
+    ASSERT_EQ(20, s->tag());
+    ASSERT_EQ(std::vector<int>(v.begin() + 10, v.begin() + 30), flatten(s));
+
+    ASSERT_EQ(t, lazy_slice(t, 0, 1000));
+    ASSERT_TRUE(lazy_slice(t, 50, 50)->isEmpty());
+    ASSERT_EQ(std::vector<int>(v.begin() + 90, v.end()),
+              flatten(lazy_slice(t, 90, 1000)));
+}
+
+// A slice's tag is not known until it is forced, and building on a slice
+// leaves it unforced.
+TEST(LazyTest, unknownTags) {
+    using Tree = Tree<int, int>;
+    auto v     = values(100);
+    auto t     = Tree::from_range(v.begin(), v.end());
+
+    auto s = lazy_slice(t, 10, 30);
+    ASSERT_FALSE(s->knownTag());
+
+    auto c = lazy_concat(s, t);
+    auto m = lazy_map(s, [](int i) { return -i; });
+    auto b = Tree::branch(t, s);
+    auto n = lazy_map(lazy_concat(t, s), [](int i) { return -i; });
+    ASSERT_TRUE(s->isPending());
+    ASSERT_FALSE(c->knownTag());
+    ASSERT_FALSE(m->knownTag());
+    ASSERT_FALSE(b->knownTag());
+    ASSERT_FALSE(n->knownTag());
+    ASSERT_EQ(120u, c->size());
+    ASSERT_EQ(20u, m->size());
+    ASSERT_EQ(120u, b->size());
+    ASSERT_EQ(120u, n->size());
+    ASSERT_EQ(100, t->knownTag());
+
+    ASSERT_EQ(120, c->tag());
+    ASSERT_FALSE(s->isPending());
+    ASSERT_EQ(20, s->knownTag());
+    ASSERT_EQ(20, m->tag());
+    ASSERT_EQ(120, b->tag());
+    ASSERT_EQ(120, n->tag());
+
+    auto slice   = std::vector<int>(v.begin() + 10, v.begin() + 30);
+    auto negated = slice;
+    for (auto& i : negated) {
+        i = -i;
+    }
+    auto expected = slice;
+    expected.insert(expected.end(), v.begin(), v.end());
+    ASSERT_EQ(expected, flatten(c));
+    ASSERT_EQ(negated, flatten(m));
+    expected = v;
+    expected.insert(expected.end(), slice.begin(), slice.end());
+    ASSERT_EQ(expected, flatten(b));
+    ASSERT_TRUE(isBalanced(concat(t, lazy_slice(t, 10, 30))));
+}
+
+TEST(LazyTest, pipeline) {
+    using Tree = Tree<int, int>;
+    auto v     = values(1000);
+    auto t     = Tree::from_range(v.begin(), v.end());
+
+    int  calls  = 0;
+    auto square = [&calls](int i) {
+        ++calls;
+        return i * i;
+    };
+    auto p = lazy_slice(lazy_map(lazy_concat(t, t), square), 990, 1010);
+    ASSERT_EQ(20u, p->size());
+    ASSERT_EQ(0, calls);
+
+    std::vector<int> expected;
+    for (int i = 990; i < 1010; ++i) {
+        expected.push_back((i % 1000) * (i % 1000));
+    }
+    ASSERT_EQ(expected, flatten(p));
+    ASSERT_EQ(20, calls);
+
+    // Ordinary operations take suspended trees as input.
+    auto q = append(-1, prepend(-2, p));
+    ASSERT_EQ(22u, q->size());
+    ASSERT_EQ(-2, head(q));
+    ASSERT_EQ(-1, last(q));
+
+    Transient<Tree> transient(p);
+    transient.push_back(7);
+    transient.push_front(8);
+    auto r = transient.persistent();
+    ASSERT_EQ(8, head(r));
+    ASSERT_EQ(7, last(r));
+    ASSERT_EQ(expected, flatten(p));
+    ASSERT_EQ(20, calls);
+}
+
+TEST(LazyTest, concurrentForcing) {
+    using Tree = Tree<int, int>;
+    auto v     = values(5000);
+    auto t     = Tree::from_range(v.begin(), v.end());
+
+    std::atomic<int> calls{0};
+    auto             m = lazy_map(t, [&calls](int i) {
+        ++calls;
+        return i + 1;
+    });
+
+    std::vector<std::thread> threads;
+    std::atomic<int>         sums{0};
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&m, &sums] {
+            auto f = flatten(m);
+            sums += std::accumulate(f.begin(), f.end(), 0);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(5000, calls);
+    ASSERT_EQ(4 * 5000 * 5001 / 2, sums);
+}
+
+TEST(LazyTest, intrusiveOwnership) {
+    using Tree =
+        Tree<int, int, SizeMeasure<int>, std::allocator<int>, LocalOwnership>;
+    auto v = values(100);
+    auto t = Tree::from_range(v.begin(), v.end());
+    auto m = lazy_slice(lazy_map(t, [](int i) { return -i; }), 40, 60);
+    ASSERT_EQ(-40, head(m));
+    ASSERT_EQ(-59, last(m));
+    ASSERT_EQ(20u, flatten(m).size());
+}
+
+// Suspensions stacked on one another are forced and freed without
+// recursing through the stack of them.
+TEST(LazyTest, deepChains) {
+    using Tree = Tree<int, int>;
+
+    auto left  = Tree::leaf(0);
+    auto right = Tree::leaf(0);
+    for (int i = 1; i < 20000; ++i) {
+        left  = lazy_concat(left, Tree::leaf(i));
+        right = lazy_concat(Tree::leaf(-i), right);
+    }
+    ASSERT_EQ(0, head(left));
+    ASSERT_EQ(19999, last(left));
+    ASSERT_EQ(-19999, head(right));
+    ASSERT_EQ(0, last(right));
+    ASSERT_EQ(values(20000), flatten(left));
+    ASSERT_EQ(20000u, flatten(right).size());
+
+    auto v      = values(8);
+    auto mapped = Tree::from_range(v.begin(), v.end());
+    for (int i = 0; i < 60000; ++i) {
+        mapped = lazy_map(mapped, [](int i) { return i + 1; });
+    }
+    ASSERT_EQ(60000, head(mapped));
+    ASSERT_EQ(60007, last(mapped));
+
+    // A slice's tag is not known until it is forced, so a chain of slices
+    // is first forced all at once.
+    auto w      = values(30000);
+    auto sliced = Tree::from_range(w.begin(), w.end());
+    for (int i = 0; i < 20000; ++i) {
+        sliced = lazy_slice(sliced, 0, sliced->size() - 1);
+    }
+    ASSERT_EQ(10000u, sliced->size());
+    ASSERT_EQ(9999, last(sliced));
+
+    auto unforced = Tree::leaf(0);
+    for (int i = 1; i < 200000; ++i) {
+        unforced = lazy_concat(unforced, Tree::leaf(i));
+    }
+    unforced.reset();
+    left.reset();
+    right.reset();
+    mapped.reset();
+    sliced.reset();
+}
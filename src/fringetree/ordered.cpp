@@ -0,0 +1,2 @@
+// ordered.cpp                                                        -*-C++-*-
+#include <fringetree/ordered.h>
@@ -0,0 +1,274 @@
+// ordered.h                                                          -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_ORDERED
+#define INCLUDED_FRINGETREE_ORDERED
+
+#include <fringetree/fringetree.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace fringetree {
+
+// The key of a set element is the element itself; the key of a map element
+// is the first of its pair.
+struct KeyIsValue {
+    template <typename Value>
+    auto operator()(Value const& v) const -> Value const& {
+        return v;
+    }
+};
+
+struct KeyIsFirst {
+    template <typename Pair>
+    auto operator()(Pair const& p) const -> decltype((p.first)) {
+        return p.first;
+    }
+};
+
+// Caches the largest key of each subtree.  The values of an ordered tree are
+// kept sorted by key, so the largest key of a branch is that of its right
+// child and 'combine' needs no comparison.  Together with the leaf count
+// every node already keeps, it lets a search by key and a search by
+// position each follow one path.
+template <typename Key,
+          typename KeyOf   = KeyIsValue,
+          typename Compare = std::less<Key>>
+struct OrderedMeasure {
+    using Key_     = Key;
+    using KeyOf_   = KeyOf;
+    using Compare_ = Compare;
+
+    static auto identity() -> std::optional<Key> { return std::nullopt; }
+
+    template <typename Value>
+    static auto leaf(Value const& v) -> std::optional<Key> {
+        return KeyOf{}(v);
+    }
+
+    static auto combine(std::optional<Key> const& left,
+                        std::optional<Key> const& right)
+        -> std::optional<Key> {
+        return right ? right : left;
+    }
+};
+
+// A persistent sorted set or map is an ordinary 'Tree' whose values are in
+// key order with no key repeated, so sequence operations that keep that
+// order, such as 'index', 'slice' and iteration, apply to it unchanged.  The
+// operations below search by key.  Like 'append', they rebuild only the path
+// they follow and share everything else with the tree they started from.
+template <typename Key,
+          typename Compare   = std::less<Key>,
+          typename Allocator = std::allocator<Key>,
+          typename Ownership = SharedOwnership>
+using OrderedSet = Tree<std::optional<Key>,
+                        Key,
+                        OrderedMeasure<Key, KeyIsValue, Compare>,
+                        Allocator,
+                        Ownership>;
+
+template <typename Key,
+          typename Mapped,
+          typename Compare   = std::less<Key>,
+          typename Allocator = std::allocator<std::pair<Key, Mapped>>,
+          typename Ownership = SharedOwnership>
+using OrderedMap = Tree<std::optional<Key>,
+                        std::pair<Key, Mapped>,
+                        OrderedMeasure<Key, KeyIsFirst, Compare>,
+                        Allocator,
+                        Ownership>;
+
+// The largest key under a non-empty node, read in place from its tag.
+template <typename Tree>
+auto ordered_max(Tree const* node) ->
+    typename Tree::Measure_::Key_ const& {
+    if (auto const* b = node->asBranch()) {
+        return *b->tag();
+    }
+    return *node->asLeaf()->tag();
+}
+
+// Sorts '[first, last)' by key and builds a balanced tree of it.  Of values
+// with equal keys the last is kept, as if each had been inserted in turn.
+template <typename Tree, typename Iterator>
+auto ordered_from_range(Iterator first, Iterator last) -> typename Tree::Ptr_ {
+    using M = typename Tree::Measure_;
+    typename M::KeyOf_   key;
+    typename M::Compare_ less;
+
+    std::vector<typename Tree::Value_> values(first, last);
+    std::stable_sort(
+        values.begin(), values.end(), [&](auto const& a, auto const& b) {
+            return less(key(a), key(b));
+        });
+    auto out = values.begin();
+    for (auto it = values.begin(); it != values.end(); ++it) {
+        auto next = std::next(it);
+        if (next == values.end() || less(key(*it), key(*next))) {
+            if (out != it) {
+                *out = std::move(*it);
+            }
+            ++out;
+        }
+    }
+    values.erase(out, values.end());
+    return Tree::from_range(std::make_move_iterator(values.begin()),
+                            std::make_move_iterator(values.end()));
+}
+
+// The number of values with keys less than 'key', which is the position of
+// the first value not less than it.  With 'index' this gives rank and
+// select; with 'slice', range scans.
+constexpr inline struct ordered_lower_bound {
+    template <typename TreePtr, typename K>
+    auto operator()(TreePtr const& tree, K const& key) const -> std::size_t {
+        using M = typename TreePtr::element_type::Measure_;
+        typename M::Compare_ less;
+        std::size_t          rank = 0;
+        auto const*          node = tree.get();
+        while (auto const* b = node->asBranch()) {
+            if (less(ordered_max(b->left().get()), key)) {
+                rank += b->left()->size();
+                node = b->right().get();
+            } else {
+                node = b->left().get();
+            }
+        }
+        if (auto const* l = node->asLeaf()) {
+            rank += less(typename M::KeyOf_{}(l->value()), key);
+        }
+        return rank;
+    }
+} ordered_lower_bound_;
+
+constexpr auto ordered_lower_bound = [](auto const& tree, auto const& key) {
+    return ordered_lower_bound_(tree, key);
+};
+
+// The value with key 'key', or null.  The pointer refers into 'tree'.
+constexpr inline struct ordered_find {
+    template <typename TreePtr, typename K>
+    auto operator()(TreePtr const& tree, K const& key) const ->
+        typename TreePtr::element_type::Value_ const* {
+        using M = typename TreePtr::element_type::Measure_;
+        typename M::Compare_ less;
+        auto const*          node = tree.get();
+        while (auto const* b = node->asBranch()) {
+            node = less(ordered_max(b->left().get()), key) ? b->right().get()
+                                                           : b->left().get();
+        }
+        auto const* l = node->asLeaf();
+        if (l == nullptr) {
+            return nullptr;
+        }
+        auto const& k = typename M::KeyOf_{}(l->value());
+        return less(k, key) || less(key, k) ? nullptr : &l->value();
+    }
+} ordered_find_;
+
+constexpr auto ordered_find = [](auto const& tree, auto const& key) {
+    return ordered_find_(tree, key);
+};
+
+constexpr auto ordered_contains = [](auto const& tree, auto const& key) {
+    return ordered_find_(tree, key) != nullptr;
+};
+
+// The values with keys in '[lo, hi)', as a tree sharing all but the cut
+// paths with 'tree'.
+constexpr auto ordered_range = [](auto tree, auto const& lo, auto const& hi) {
+    auto first = ordered_lower_bound_(tree, lo);
+    auto last  = std::max(first, ordered_lower_bound_(tree, hi));
+    return split_at_(split_at_(tree, last).first, first).second;
+};
+
+// Inserts 'v', replacing any value with the same key.  The search descends
+// to the leaf next to where 'v' belongs, which becomes a branch holding
+// both, and the path back up is rebalanced as 'append' does.
+constexpr inline struct ordered_insert {
+    template <typename V, typename TreePtr>
+    auto operator()(V v, TreePtr const& tree) const -> TreePtr {
+        using Tree_ = typename TreePtr::element_type;
+        using M     = typename Tree_::Measure_;
+        typename M::KeyOf_   key;
+        typename M::Compare_ less;
+
+        PathStack<std::pair<typename Tree_::Branch_ const*, bool>> path;
+        auto const*                                              node = &tree;
+        while (auto const* b = (*node)->asBranch()) {
+            auto left = !less(ordered_max(b->left().get()), key(v));
+            path.push({b, left});
+            node = left ? &b->left() : &b->right();
+        }
+
+        auto const* l = (*node)->asLeaf();
+        TreePtr     result;
+        if (l == nullptr) {
+            result = Tree_::leaf(std::move(v));
+        } else if (less(key(v), key(l->value()))) {
+            result = Tree_::branch(Tree_::leaf(std::move(v)), *node);
+        } else if (less(key(l->value()), key(v))) {
+            result = Tree_::branch(*node, Tree_::leaf(std::move(v)));
+        } else {
+            result = Tree_::leaf(std::move(v));
+        }
+        while (!path.empty()) {
+            auto [b, wentLeft] = path.pop();
+            result = wentLeft ? balance_(result, b->right())
+                              : balance_(b->left(), result);
+        }
+        return result;
+    }
+} ordered_insert_;
+
+constexpr auto ordered_insert = [](auto v, auto tree) {
+    return ordered_insert_(std::move(v), tree);
+};
+
+// Removes the value with key 'key', if there is one.  Otherwise 'tree' is
+// returned as it is, without rebuilding anything.
+constexpr inline struct ordered_erase {
+    template <typename TreePtr, typename K>
+    auto operator()(TreePtr const& tree, K const& key) const -> TreePtr {
+        using Tree_ = typename TreePtr::element_type;
+        using M     = typename Tree_::Measure_;
+        typename M::Compare_ less;
+
+        PathStack<std::pair<typename Tree_::Branch_ const*, bool>> path;
+        auto const*                                              node = &tree;
+        while (auto const* b = (*node)->asBranch()) {
+            auto left = !less(ordered_max(b->left().get()), key);
+            path.push({b, left});
+            node = left ? &b->left() : &b->right();
+        }
+
+        auto const* l = (*node)->asLeaf();
+        if (l == nullptr) {
+            return tree;
+        }
+        auto const& k = typename M::KeyOf_{}(l->value());
+        if (less(k, key) || less(key, k)) {
+            return tree;
+        }
+        auto result = Tree_::empty();
+        while (!path.empty()) {
+            auto [b, wentLeft] = path.pop();
+            result = wentLeft ? balance_(result, b->right())
+                              : balance_(b->left(), result);
+        }
+        return result;
+    }
+} ordered_erase_;
+
+constexpr auto ordered_erase = [](auto tree, auto const& key) {
+    return ordered_erase_(tree, key);
+};
+
+} // namespace fringetree
+
+#endif
@@ -0,0 +1,113 @@
+#include <fringetree/ordered.h>
+#include <fringetree/intrusive.h>
+#include <fringetree/testsupport.t.h>
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace fringetree;
+using namespace fringetree::test;
+
+TEST(OrderedTest, set) {
+    using Set = OrderedSet<int>;
+    auto s    = Set::empty();
+    for (int i : {5, 3, 8, 1, 4, 7, 9, 2, 6, 3, 5}) {
+        s = ordered_insert(i, s);
+    }
+    ASSERT_EQ((std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8, 9}), flatten(s));
+    ASSERT_EQ(9, *s->tag());
+
+    ASSERT_TRUE(ordered_contains(s, 4));
+    ASSERT_FALSE(ordered_contains(s, 10));
+    ASSERT_FALSE(ordered_contains(Set::empty(), 1));
+    ASSERT_EQ(7, *ordered_find(s, 7));
+
+    // Rank and select.
+    ASSERT_EQ(0u, ordered_lower_bound(s, 0));
+    ASSERT_EQ(3u, ordered_lower_bound(s, 4));
+    ASSERT_EQ(9u, ordered_lower_bound(s, 100));
+    ASSERT_EQ(4, fringetree::index(s, ordered_lower_bound(s, 4)));
+
+    ASSERT_EQ((std::vector<int>{3, 4, 5, 6}),
+              flatten(ordered_range(s, 3, 7)));
+    ASSERT_TRUE(ordered_range(s, 7, 3)->isEmpty());
+
+    auto t = ordered_erase(s, 5);
+    ASSERT_EQ((std::vector<int>{1, 2, 3, 4, 6, 7, 8, 9}), flatten(t));
+    ASSERT_EQ(s, ordered_erase(s, 42));
+    ASSERT_EQ(9u, s->size());
+    ASSERT_TRUE(ordered_erase(ordered_insert(1, Set::empty()), 1)->isEmpty());
+}
+
+TEST(OrderedTest, map) {
+    using Map = OrderedMap<std::string, int>;
+    std::vector<std::pair<std::string, int>> values{
+        {"pear", 1}, {"apple", 2}, {"fig", 3}, {"apple", 4}};
+    auto m = ordered_from_range<Map>(values.begin(), values.end());
+    ASSERT_EQ(3u, m->size());
+    ASSERT_EQ(4, ordered_find(m, std::string("apple"))->second);
+
+    auto n = ordered_insert(std::pair<std::string, int>{"fig", 30}, m);
+    ASSERT_EQ(30, ordered_find(n, std::string("fig"))->second);
+    ASSERT_EQ(3, ordered_find(m, std::string("fig"))->second);
+    ASSERT_EQ("pear", *n->tag());
+}
+
+TEST(OrderedTest, matchesStdSet) {
+    using Set = OrderedSet<int, std::greater<int>>;
+    std::mt19937                       rng(7);
+    std::uniform_int_distribution<int> keys(0, 2000);
+    std::set<int, std::greater<int>>   expected;
+    std::vector<Set::Ptr_>             versions;
+    std::vector<std::vector<int>>      contents;
+
+    auto s = Set::empty();
+    for (int i = 0; i < 4000; ++i) {
+        auto k = keys(rng);
+        if (i % 3 == 2) {
+            s = ordered_erase(s, k);
+            expected.erase(k);
+        } else {
+            s = ordered_insert(k, s);
+            expected.insert(k);
+        }
+        if (i % 500 == 0) {
+            ASSERT_TRUE(isBalanced(s));
+            versions.push_back(s);
+            contents.emplace_back(expected.begin(), expected.end());
+        }
+    }
+
+    ASSERT_EQ(std::vector<int>(expected.begin(), expected.end()), flatten(s));
+    ASSERT_TRUE(isBalanced(s));
+    for (int k = -1; k <= 2001; ++k) {
+        ASSERT_EQ(expected.count(k) != 0, ordered_contains(s, k));
+        auto rank = std::size_t(std::distance(expected.begin(),
+                                              expected.lower_bound(k)));
+        ASSERT_EQ(rank, ordered_lower_bound(s, k));
+    }
+
+    // Every saved version still holds what it held when it was saved.
+    for (std::size_t i = 0; i < versions.size(); ++i) {
+        ASSERT_EQ(contents[i], flatten(versions[i]));
+    }
+}
+
+TEST(OrderedTest, intrusiveOwnership) {
+    using Set =
+        OrderedSet<int, std::less<int>, std::allocator<int>, LocalOwnership>;
+    auto s = Set::empty();
+    for (int i = 100; i-- > 0;) {
+        s = ordered_insert(i, s);
+    }
+    ASSERT_EQ(100u, s->size());
+    ASSERT_TRUE(isBalanced(s));
+    ASSERT_EQ(50u, ordered_lower_bound(s, 50));
+    ASSERT_EQ(99u, ordered_erase(s, 0)->size());
+}
@@ -0,0 +1,129 @@
+// parallel.cpp                                                       -*-C++-*-
+#include <fringetree/parallel.h>
+
+namespace fringetree {
+
+namespace {
+thread_local WorkStealingPool const* currentPool  = nullptr;
+thread_local std::size_t             currentIndex = 0;
+} // namespace
+
+void WorkStealingPool::Task::run() noexcept {
+    try {
+        execute();
+    } catch (...) {
+        error_ = std::current_exception();
+    }
+    done_.store(true, std::memory_order_release);
+}
+
+// Workers fork onto their own deque; every other thread shares the last one.
+auto WorkStealingPool::home() const -> std::size_t {
+    return currentPool == this ? currentIndex : threads_.size();
+}
+
+void WorkStealingPool::push(Task* task) {
+    {
+        auto&                       queue = *queues_[home()];
+        std::lock_guard<std::mutex> lock(queue.mutex_);
+        queue.tasks_.push_back(task);
+    }
+    pending_.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(sleep_);
+    }
+    wake_.notify_one();
+}
+
+// Takes 'task' back if no one has stolen it.  Anything forked after it has
+// already been joined, so if it is still queued it is at the back.
+auto WorkStealingPool::reclaim(Task* task) -> bool {
+    auto&                       queue = *queues_[home()];
+    std::lock_guard<std::mutex> lock(queue.mutex_);
+    if (queue.tasks_.empty() || queue.tasks_.back() != task) {
+        return false;
+    }
+    queue.tasks_.pop_back();
+    pending_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+auto WorkStealingPool::runOne(std::size_t index) -> bool {
+    Task* task = nullptr;
+    {
+        auto&                       queue = *queues_[index];
+        std::lock_guard<std::mutex> lock(queue.mutex_);
+        if (!queue.tasks_.empty()) {
+            task = queue.tasks_.back();
+            queue.tasks_.pop_back();
+        }
+    }
+    for (std::size_t i = 1; task == nullptr && i < queues_.size(); ++i) {
+        auto& queue = *queues_[(index + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex_);
+        if (!queue.tasks_.empty()) {
+            task = queue.tasks_.front();
+            queue.tasks_.pop_front();
+        }
+    }
+    if (task == nullptr) {
+        return false;
+    }
+    pending_.fetch_sub(1, std::memory_order_relaxed);
+    task->run();
+    return true;
+}
+
+void WorkStealingPool::join(Task& task) {
+    auto index = home();
+    while (!task.done_.load(std::memory_order_acquire)) {
+        if (!runOne(index)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void WorkStealingPool::work(std::size_t index) {
+    currentPool  = this;
+    currentIndex = index;
+    for (;;) {
+        if (runOne(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_);
+        wake_.wait(lock, [this] {
+            return stop_ || pending_.load(std::memory_order_acquire) != 0;
+        });
+        if (stop_) {
+            return;
+        }
+    }
+}
+
+WorkStealingPool::WorkStealingPool(std::size_t threads) {
+    threads = threads == 0 ? 1 : threads;
+    for (std::size_t i = 0; i <= threads; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i] { work(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+auto WorkStealingPool::shared() -> WorkStealingPool& {
+    static WorkStealingPool pool;
+    return pool;
+}
+
+} // namespace fringetree
@@ -0,0 +1,280 @@
+// parallel.h                                                         -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_PARALLEL
+#define INCLUDED_FRINGETREE_PARALLEL
+
+#include <fringetree/fringetree.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fringetree {
+
+// A fork-join pool.  Each worker keeps its own deque of forked tasks,
+// pushing and popping at the back, and when it runs dry it steals from the
+// front of the other deques.  Threads outside the pool fork onto one more
+// shared deque.  A thread waiting for a task that was stolen runs other
+// tasks until it completes, so nested forks never block a worker.
+class WorkStealingPool {
+  public:
+    class Task {
+        friend class WorkStealingPool;
+
+        std::atomic<bool>  done_{false};
+        std::exception_ptr error_;
+
+      protected:
+        virtual void execute() = 0;
+        ~Task()                = default;
+
+      public:
+        void run() noexcept;
+    };
+
+  private:
+    struct Queue {
+        std::mutex        mutex_;
+        std::deque<Task*> tasks_;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread>            threads_;
+    std::atomic<std::size_t>            pending_{0};
+    std::mutex                          sleep_;
+    std::condition_variable             wake_;
+    bool                                stop_ = false;
+
+    template <typename F>
+    class Job : public Task {
+        F& f_;
+        void execute() override { f_(); }
+
+      public:
+        explicit Job(F& f) : f_(f) {}
+    };
+
+    auto home() const -> std::size_t;
+    void push(Task* task);
+    auto reclaim(Task* task) -> bool;
+    auto runOne(std::size_t index) -> bool;
+    void join(Task& task);
+    void work(std::size_t index);
+
+  public:
+    // Starts 'threads' workers, at least one.
+    explicit WorkStealingPool(
+        std::size_t threads = std::thread::hardware_concurrency());
+    ~WorkStealingPool();
+
+    WorkStealingPool(WorkStealingPool const&)                    = delete;
+    auto operator=(WorkStealingPool const&) -> WorkStealingPool& = delete;
+
+    auto size() const -> std::size_t { return threads_.size(); }
+
+    // Runs 'f' and 'g', possibly in parallel, and returns when both have.
+    // If either throws, the exception is rethrown here once both are done.
+    template <typename F, typename G>
+    void fork_join(F&& f, G&& g) {
+        Job<std::remove_reference_t<G>> job(g);
+        push(&job);
+        std::exception_ptr error;
+        try {
+            f();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        if (reclaim(&job)) {
+            job.run();
+        } else {
+            join(job);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if (job.error_) {
+            std::rethrow_exception(job.error_);
+        }
+    }
+
+    // A process-wide pool with one worker per hardware thread.
+    static auto shared() -> WorkStealingPool&;
+};
+
+// Subtrees with no more leaves than this are processed on one thread.
+constexpr std::size_t parallel_grain = 4096;
+
+// The parallel algorithms fork only at branches that are large and within
+// the weight balance bound, so neither side of a fork has more than three
+// quarters of the work and recursion stays logarithmic.  Anything else,
+// including a spine built directly with 'Tree::branch', is handled
+// sequentially without recursion.
+constexpr inline struct parallel_fork {
+    template <typename Branch>
+    auto operator()(Branch const& b, std::size_t grain) const -> bool {
+        return b.size() > grain && !balance::heavy(b.left(), b.right()) &&
+               !balance::heavy(b.right(), b.left());
+    }
+} parallel_fork_;
+
+// Folds 'monoid' over the leaves, which is anything shaped like a measure
+// policy: 'identity()', 'leaf(value)' and an associative 'combine(a, b)'.
+constexpr inline struct parallel_reduce {
+    template <typename Tree, typename Monoid>
+    static auto reduce(Tree const*       node,
+                       Monoid const&     monoid,
+                       WorkStealingPool& pool,
+                       std::size_t       grain) {
+        using R       = decltype(monoid.identity());
+        auto const* b = node->asBranch();
+        if (b == nullptr || !parallel_fork_(*b, grain)) {
+            R acc = monoid.identity();
+            for (auto const& v : *node) {
+                acc = monoid.combine(acc, monoid.leaf(v));
+            }
+            return acc;
+        }
+        std::optional<R> left;
+        std::optional<R> right;
+        pool.fork_join(
+            [&] { left = reduce(b->left().get(), monoid, pool, grain); },
+            [&] { right = reduce(b->right().get(), monoid, pool, grain); });
+        return monoid.combine(*left, *right);
+    }
+
+    template <typename TreePtr, typename Monoid>
+    auto operator()(TreePtr const&    tree,
+                    Monoid const&     monoid,
+                    WorkStealingPool& pool  = WorkStealingPool::shared(),
+                    std::size_t       grain = parallel_grain) const {
+        return reduce(tree.get(), monoid, pool, grain);
+    }
+} parallel_reduce_;
+
+constexpr auto parallel_reduce = [](auto tree, auto const& monoid) {
+    return parallel_reduce_(tree, monoid);
+};
+
+// The tree 'parallel_map' builds from 'Tree' when 'f' returns 'U'.
+template <typename Tree, typename U>
+using MappedTree = fringetree::Tree<
+    typename Tree::Tag_,
+    U,
+    typename Tree::Measure_,
+    typename std::allocator_traits<
+        typename Tree::Allocator_>::template rebind_alloc<U>,
+    typename Tree::Ownership_>;
+
+// Builds a tree of the same shape holding 'f' of each value.  Nodes are
+// allocated on whichever thread builds them, so with 'ResourceAllocator'
+// they come from that thread's current resource.
+constexpr inline struct parallel_map {
+    template <typename Out, typename Tree, typename F>
+    static auto sequential(Tree const* root, F const& f) -> Ptr<Out> {
+        struct Frame {
+            Tree const* node_;
+            bool        built_;
+        };
+        std::vector<Frame>    stack{{root, false}};
+        std::vector<Ptr<Out>> built;
+        while (!stack.empty()) {
+            auto frame = stack.back();
+            stack.pop_back();
+            if (auto const* b = frame.node_->asBranch()) {
+                if (frame.built_) {
+                    auto right = std::move(built.back());
+                    built.pop_back();
+                    built.back() =
+                        Out::branch(std::move(built.back()), std::move(right));
+                } else {
+                    stack.push_back({frame.node_, true});
+                    stack.push_back({b->right().get(), false});
+                    stack.push_back({b->left().get(), false});
+                }
+            } else if (auto const* l = frame.node_->asLeaf()) {
+                built.push_back(Out::leaf(f(l->value())));
+            } else {
+                built.push_back(Out::empty());
+            }
+        }
+        return built.back();
+    }
+
+    template <typename Out, typename Tree, typename F>
+    static auto map(Tree const*       node,
+                    F const&          f,
+                    WorkStealingPool& pool,
+                    std::size_t       grain) -> Ptr<Out> {
+        auto const* b = node->asBranch();
+        if (b == nullptr || !parallel_fork_(*b, grain)) {
+            return sequential<Out>(node, f);
+        }
+        Ptr<Out> left;
+        Ptr<Out> right;
+        pool.fork_join(
+            [&] { left = map<Out>(b->left().get(), f, pool, grain); },
+            [&] { right = map<Out>(b->right().get(), f, pool, grain); });
+        return Out::branch(std::move(left), std::move(right));
+    }
+
+    template <typename TreePtr, typename F>
+    auto operator()(TreePtr const&    tree,
+                    F const&          f,
+                    WorkStealingPool& pool  = WorkStealingPool::shared(),
+                    std::size_t       grain = parallel_grain) const {
+        using Tree_ = typename TreePtr::element_type;
+        using V     = typename Tree_::Value_;
+        using U     = std::decay_t<std::invoke_result_t<F const&, V const&>>;
+        return map<MappedTree<Tree_, U>>(tree.get(), f, pool, grain);
+    }
+} parallel_map_;
+
+constexpr auto parallel_map = [](auto tree, auto const& f) {
+    return parallel_map_(tree, f);
+};
+
+// Copies the fringe into a vector, each forked half writing its own range.
+// 'Value' must be default constructible.
+constexpr inline struct parallel_flatten {
+    template <typename Tree, typename Out>
+    static void fill(Tree const*       node,
+                     Out               out,
+                     WorkStealingPool& pool,
+                     std::size_t       grain) {
+        auto const* b = node->asBranch();
+        if (b == nullptr || !parallel_fork_(*b, grain)) {
+            std::copy(node->begin(), node->end(), out);
+            return;
+        }
+        auto middle = out + b->left()->size();
+        pool.fork_join(
+            [&] { fill(b->left().get(), out, pool, grain); },
+            [&] { fill(b->right().get(), middle, pool, grain); });
+    }
+
+    template <typename TreePtr>
+    auto operator()(TreePtr const&    tree,
+                    WorkStealingPool& pool  = WorkStealingPool::shared(),
+                    std::size_t       grain = parallel_grain) const {
+        std::vector<typename TreePtr::element_type::Value_> v(tree->size());
+        fill(tree.get(), v.begin(), pool, grain);
+        return v;
+    }
+} parallel_flatten_;
+
+constexpr auto parallel_flatten = [](auto tree) {
+    return parallel_flatten_(tree);
+};
+
+} // namespace fringetree
+
+#endif
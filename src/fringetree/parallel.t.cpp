@@ -0,0 +1,137 @@
+#include <fringetree/parallel.h>
+#include <fringetree/testsupport.t.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace fringetree;
+using namespace fringetree::test;
+
+namespace {
+struct Sum {
+    static auto identity() -> long { return 0; }
+    static auto leaf(int v) -> long { return v; }
+    static auto combine(long a, long b) -> long { return a + b; }
+};
+
+// Not commutative, so any reordering of the leaves would show.
+struct Concat {
+    static auto identity() -> std::string { return {}; }
+    static auto leaf(int v) -> std::string { return std::to_string(v % 10); }
+    static auto combine(std::string const& a, std::string const& b)
+        -> std::string {
+        return a + b;
+    }
+};
+
+template <typename A, typename B>
+bool sameShape(A const& a, B const& b) {
+    auto const* ab = a->asBranch();
+    auto const* bb = b->asBranch();
+    if (ab == nullptr || bb == nullptr) {
+        return ab == nullptr && bb == nullptr && a->size() == b->size();
+    }
+    return sameShape(ab->left(), bb->left()) &&
+           sameShape(ab->right(), bb->right());
+}
+} // namespace
+
+TEST(ParallelTest, forkJoin) {
+    WorkStealingPool pool(4);
+    ASSERT_EQ(4u, pool.size());
+
+    std::atomic<int>         count{0};
+    std::function<void(int)> fork = [&](int depth) {
+        if (depth == 0) {
+            ++count;
+            return;
+        }
+        pool.fork_join([&] { fork(depth - 1); }, [&] { fork(depth - 1); });
+    };
+    fork(12);
+    ASSERT_EQ(4096, count);
+
+    ASSERT_THROW(pool.fork_join([] {}, [] { throw std::runtime_error("g"); }),
+                 std::runtime_error);
+    ASSERT_THROW(pool.fork_join([] { throw std::runtime_error("f"); }, [] {}),
+                 std::runtime_error);
+}
+
+TEST(ParallelTest, reduce) {
+    using Tree = Tree<int, int>;
+    WorkStealingPool pool(4);
+    auto             v = values(100000);
+    auto             t = Tree::from_range(v.begin(), v.end());
+
+    long expected = std::accumulate(v.begin(), v.end(), 0L);
+    ASSERT_EQ(expected, parallel_reduce(t, Sum{}));
+    ASSERT_EQ(expected, parallel_reduce_(t, Sum{}, pool, 16));
+    ASSERT_EQ(0, parallel_reduce(Tree::empty(), Sum{}));
+
+    auto small = values(10000);
+    auto u     = Tree::from_range(small.begin(), small.end());
+    auto s     = parallel_reduce_(u, Concat{}, pool, 64);
+    ASSERT_EQ(std::size_t(10000), s.size());
+    ASSERT_EQ(Concat::leaf(5432), s.substr(5432, 1));
+    ASSERT_EQ(s, parallel_reduce_(u, Concat{}, pool, 1 << 20));
+}
+
+TEST(ParallelTest, map) {
+    using Tree = Tree<int, int>;
+    WorkStealingPool pool(4);
+    auto             v = values(50000);
+    auto             t = Tree::from_range(v.begin(), v.end());
+    for (int i = 0; i < 1000; ++i) {
+        t = append(i, t);
+    }
+
+    auto doubled = parallel_map_(t, [](int i) { return 2.0 * i; }, pool, 32);
+    using Doubled = typename decltype(doubled)::element_type;
+    static_assert(std::is_same_v<double, typename Doubled::Value_>);
+    ASSERT_TRUE(sameShape(t, doubled));
+    auto flat = flatten(t);
+    auto out  = flatten(doubled);
+    for (std::size_t i = 0; i < flat.size(); ++i) {
+        ASSERT_EQ(2.0 * flat[i], out[i]);
+    }
+
+    auto strings = parallel_map(t, [](int i) { return std::to_string(i); });
+    ASSERT_EQ("49999", fringetree::index(strings, 49999));
+
+    ASSERT_THROW(parallel_map_(
+                     t,
+                     [](int i) {
+                         if (i == 40000) {
+                             throw std::out_of_range("map");
+                         }
+                         return i;
+                     },
+                     pool,
+                     32),
+                 std::out_of_range);
+}
+
+TEST(ParallelTest, flatten) {
+    using Tree = Tree<int, int>;
+    WorkStealingPool pool(3);
+    auto             v = values(100000);
+    auto             t = Tree::from_range(v.begin(), v.end());
+    t                  = concat(t, prepend(-1, t));
+    ASSERT_EQ(flatten(t), parallel_flatten_(t, pool, 100));
+    ASSERT_EQ(flatten(t), parallel_flatten(t));
+    ASSERT_TRUE(parallel_flatten(Tree::empty()).empty());
+
+    auto spine = Tree::empty();
+    for (int i = 0; i < 20000; ++i) {
+        spine = Tree::branch(spine, Tree::leaf(i));
+    }
+    ASSERT_EQ(flatten(spine), parallel_flatten_(spine, pool, 16));
+    ASSERT_EQ(flatten(spine), flatten(parallel_map_(
+                                  spine, [](int i) { return i; }, pool, 16)));
+}
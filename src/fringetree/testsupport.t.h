@@ -0,0 +1,106 @@
+// testsupport.t.h                                                    -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_TESTSUPPORT
+#define INCLUDED_FRINGETREE_TESTSUPPORT
+
+#include <fringetree/fringetree.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <numeric>
+#include <vector>
+
+// Helpers shared by the unit tests.  Not installed with the library headers.
+namespace fringetree::test {
+
+// '0, 1, ..., n - 1'.
+inline auto values(int n) -> std::vector<int> {
+    std::vector<int> v(n);
+    std::iota(v.begin(), v.end(), 0);
+    return v;
+}
+
+// '[first, last)' appended one at a time, so the tree is shaped by 'append'.
+template <typename Tree>
+auto build(int first, int last) {
+    auto t = Tree::empty();
+    for (int i = first; i < last; ++i) {
+        t = append(i, t);
+    }
+    return t;
+}
+
+// Whether every branch is within the weight-balance bound.  It recurses, so
+// it is only for trees that are expected to pass.
+template <typename TreePtr>
+bool isBalanced(TreePtr const& tree) {
+    auto const* b = tree->asBranch();
+    if (b == nullptr) {
+        return true;
+    }
+    auto l = b->left()->size();
+    auto r = b->right()->size();
+    return l <= balance::delta * r && r <= balance::delta * l &&
+           isBalanced(b->left()) && isBalanced(b->right());
+}
+
+// Checks every branch's cached end leaves against a walk down its spines.
+template <typename TreePtr>
+bool fingersHold(TreePtr const& tree) {
+    std::vector<typename TreePtr::element_type const*> stack{tree.get()};
+    while (!stack.empty()) {
+        auto const* node = stack.back();
+        stack.pop_back();
+        if (auto const* b = node->asBranch()) {
+            auto const* l = node;
+            while (auto const* lb = l->asBranch()) {
+                l = lb->left().get();
+            }
+            auto const* r = node;
+            while (auto const* rb = r->asBranch()) {
+                r = rb->right().get();
+            }
+            if (b->front() != l || b->back() != r) {
+                return false;
+            }
+            stack.push_back(b->left().get());
+            stack.push_back(b->right().get());
+        }
+    }
+    return true;
+}
+
+// Counts the allocations passed on to 'upstream' and the largest of them.
+class CountingResource : public std::pmr::memory_resource {
+    std::pmr::memory_resource* upstream_;
+
+  public:
+    int         allocations_   = 0;
+    int         deallocations_ = 0;
+    std::size_t largest_       = 0;
+
+    explicit CountingResource(
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : upstream_(upstream) {}
+
+  private:
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        ++allocations_;
+        largest_ = std::max(largest_, bytes);
+        return upstream_->allocate(bytes, align);
+    }
+
+    void
+    do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+        ++deallocations_;
+        upstream_->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(memory_resource const& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+} // namespace fringetree::test
+
+#endif
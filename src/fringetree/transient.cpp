@@ -0,0 +1,2 @@
+// transient.cpp                                                      -*-C++-*-
+#include <fringetree/transient.h>
@@ -0,0 +1,185 @@
+// transient.h                                                        -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_TRANSIENT
+#define INCLUDED_FRINGETREE_TRANSIENT
+
+#include <fringetree/fringetree.h>
+
+#include <cstddef>
+#include <utility>
+#include <variant>
+
+namespace fringetree {
+
+// A mutable builder over a persistent tree, for batches of updates whose
+// intermediate versions are never observed.  Starting a transient from a
+// tree is O(1) and shares the whole tree.  The first update along a path
+// copies the shared nodes on it.  Later updates find those copies owned by
+// the transient alone and rewrite them in place, rotations included.  A
+// batch therefore allocates one node per node it adds, not one per path
+// copy.
+//
+// A node is owned when the transient holds its only reference, so no one
+// else can see it being rewritten.  'persistent()' hands the tree back in
+// O(1) and leaves the transient empty, so a tree is never changed once it
+// has been handed out.
+//
+// Other threads may hold and drop references to the nodes of the tree a
+// transient starts from while it runs, as snapshot readers of 'Versioned'
+// do.  'sole_owner' orders each rewrite after every such release.  A
+// transient itself is used by one thread at a time.
+template <typename Tree>
+class Transient {
+    using Ptr_     = typename Tree::Ptr_;
+    using Value_   = typename Tree::Value_;
+    using Measure_ = typename Tree::Measure_;
+    using Branch_  = typename Tree::Branch_;
+
+    Ptr_ root_;
+
+    // The children of a branch, along with the branch itself when it is
+    // owned and may be rebuilt in place.
+    struct Opened {
+        Ptr_ left_;
+        Ptr_ right_;
+        Ptr_ spare_;
+    };
+
+    // A suspended node is opened through its result.  When the transient
+    // held the only reference to the suspension, 'resolve' hands the result
+    // over, and it is rebuilt in place if nothing else refers to it either;
+    // otherwise it is shared with the suspension and copied.
+    static auto open(Ptr_&& node) -> Opened {
+        if (node->isSuspended()) {
+            node = Tree::resolve(std::move(node));
+        }
+        auto* b = std::get_if<Branch_>(&node->data_);
+        if (sole_owner(node)) {
+            return Opened{std::move(b->left_), std::move(b->right_),
+                          std::move(node)};
+        }
+        return Opened{b->left_, b->right_, Ptr_()};
+    }
+
+    // A child whose tag is not known yet is left to 'Tree::branch', which
+    // does not force it.
+    static auto make(Ptr_&& spare, Ptr_&& left, Ptr_&& right) -> Ptr_ {
+        auto leftTag  = left->knownTag();
+        auto rightTag = right->knownTag();
+        if (!spare || !leftTag || !rightTag) {
+            return Tree::branch(std::move(left), std::move(right));
+        }
+        auto* b   = std::get_if<Branch_>(&spare->data_);
+        b->tag_   = Measure_::combine(*leftTag, *rightTag);
+        b->size_  = left->size() + right->size();
+        b->left_  = std::move(left);
+        b->right_ = std::move(right);
+        b->front_ = Branch_::leftmost(b->left_.get());
+        b->back_  = Branch_::rightmost(b->right_.get());
+        return std::move(spare);
+    }
+
+    // 'balance_', recycling 'spare' and any owned branches it rotates.
+    static auto join(Ptr_&& spare, Ptr_&& l, Ptr_&& r) -> Ptr_ {
+        if (l->isEmpty()) {
+            return std::move(r);
+        }
+        if (r->isEmpty()) {
+            return std::move(l);
+        }
+
+        if (balance::heavy(r, l)) {
+            auto [rl, rr, rs] = open(std::move(r));
+            if (rl->size() < balance::gamma * rr->size()) {
+                auto inner = make(std::move(rs), std::move(l), std::move(rl));
+                return make(std::move(spare), std::move(inner), std::move(rr));
+            }
+            auto [rll, rlr, rls] = open(std::move(rl));
+            auto lower = make(std::move(rs), std::move(l), std::move(rll));
+            auto upper = make(std::move(rls), std::move(rlr), std::move(rr));
+            return make(std::move(spare), std::move(lower), std::move(upper));
+        }
+
+        if (balance::heavy(l, r)) {
+            auto [ll, lr, ls] = open(std::move(l));
+            if (lr->size() < balance::gamma * ll->size()) {
+                auto inner = make(std::move(ls), std::move(lr), std::move(r));
+                return make(std::move(spare), std::move(ll), std::move(inner));
+            }
+            auto [lrl, lrr, lrs] = open(std::move(lr));
+            auto lower = make(std::move(ls), std::move(ll), std::move(lrl));
+            auto upper = make(std::move(lrs), std::move(lrr), std::move(r));
+            return make(std::move(spare), std::move(lower), std::move(upper));
+        }
+
+        return make(std::move(spare), std::move(l), std::move(r));
+    }
+
+    // The branches left behind on the way down to the end a value is pushed
+    // onto: the child not followed and the branch itself when owned.
+    struct Frame {
+        Ptr_ other_;
+        Ptr_ spare_;
+    };
+
+    // Descends the right spine, opening each branch, and rebuilds it from
+    // the bottom with 'join'.  The path is kept on a 'PathStack' rather than
+    // the call stack, so a spine of any depth can be pushed onto.
+    static auto pushBack(Ptr_&& node, Value_&& v) -> Ptr_ {
+        PathStack<Frame> path;
+        while (node->asBranch() != nullptr) {
+            auto [l, r, spare] = open(std::move(node));
+            path.push(Frame{std::move(l), std::move(spare)});
+            node = std::move(r);
+        }
+        auto result = node->isEmpty()
+                          ? Tree::leaf(std::move(v))
+                          : Tree::branch(std::move(node),
+                                         Tree::leaf(std::move(v)));
+        while (!path.empty()) {
+            auto [l, spare] = path.pop();
+            result = join(std::move(spare), std::move(l), std::move(result));
+        }
+        return result;
+    }
+
+    static auto pushFront(Ptr_&& node, Value_&& v) -> Ptr_ {
+        PathStack<Frame> path;
+        while (node->asBranch() != nullptr) {
+            auto [l, r, spare] = open(std::move(node));
+            path.push(Frame{std::move(r), std::move(spare)});
+            node = std::move(l);
+        }
+        auto result = node->isEmpty()
+                          ? Tree::leaf(std::move(v))
+                          : Tree::branch(Tree::leaf(std::move(v)),
+                                         std::move(node));
+        while (!path.empty()) {
+            auto [r, spare] = path.pop();
+            result = join(std::move(spare), std::move(result), std::move(r));
+        }
+        return result;
+    }
+
+  public:
+    Transient() : root_(Tree::empty()) {}
+    explicit Transient(Ptr_ tree) : root_(std::move(tree)) {}
+
+    Transient(Transient const&)                    = delete;
+    auto operator=(Transient const&) -> Transient& = delete;
+
+    auto size() const -> std::size_t { return root_->size(); }
+
+    void push_back(Value_ v) {
+        root_ = pushBack(std::move(root_), std::move(v));
+    }
+
+    void push_front(Value_ v) {
+        root_ = pushFront(std::move(root_), std::move(v));
+    }
+
+    auto persistent() -> Ptr_ { return std::exchange(root_, Tree::empty()); }
+};
+
+} // namespace fringetree
+
+#endif
@@ -0,0 +1,150 @@
+#include <fringetree/transient.h>
+#include <fringetree/allocator.h>
+#include <fringetree/intrusive.h>
+#include <fringetree/testsupport.t.h>
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <vector>
+
+using namespace fringetree;
+using namespace fringetree::test;
+
+TEST(TransientTest, pushBack) {
+    using Tree = Tree<int, int>;
+    Transient<Tree> transient;
+    for (int i = 0; i < 1000; ++i) {
+        transient.push_back(i);
+    }
+    ASSERT_EQ(1000u, transient.size());
+    auto t = transient.persistent();
+    ASSERT_EQ(0u, transient.size());
+
+    std::vector<int> expected(1000);
+    std::iota(expected.begin(), expected.end(), 0);
+    ASSERT_EQ(expected, flatten(t));
+    ASSERT_TRUE(isBalanced(t));
+}
+
+TEST(TransientTest, mixed) {
+    using Tree = Tree<int, int>;
+    Transient<Tree> transient;
+    std::vector<int> expected;
+    for (int i = 0; i < 500; ++i) {
+        if (i % 3 == 0) {
+            transient.push_front(i);
+            expected.insert(expected.begin(), i);
+        } else {
+            transient.push_back(i);
+            expected.push_back(i);
+        }
+    }
+    auto t = transient.persistent();
+    ASSERT_EQ(expected, flatten(t));
+    ASSERT_TRUE(isBalanced(t));
+    ASSERT_TRUE(fingersHold(t));
+    ASSERT_EQ(expected.front(), head(t));
+    ASSERT_EQ(expected.back(), last(t));
+}
+
+TEST(TransientTest, leavesSourceUnchanged) {
+    using Tree = Tree<int, int>;
+    std::vector<int> values(300);
+    std::iota(values.begin(), values.end(), 0);
+    auto source = Tree::from_range(values.begin(), values.end());
+
+    Transient<Tree> transient(source);
+    for (int i = 0; i < 300; ++i) {
+        transient.push_back(300 + i);
+        transient.push_front(-1 - i);
+    }
+    auto t = transient.persistent();
+    ASSERT_EQ(values, flatten(source));
+    ASSERT_EQ(900u, t->size());
+    ASSERT_EQ(-300, head(t));
+    ASSERT_EQ(599, last(t));
+    ASSERT_TRUE(isBalanced(t));
+
+    // A frozen tree is shared from then on, so a new transient over it copies
+    // rather than rewriting it.
+    Transient<Tree> again(t);
+    again.push_back(600);
+    ASSERT_EQ(900u, t->size());
+    ASSERT_EQ(901u, again.size());
+}
+
+TEST(TransientTest, allocatesOnlyNewNodes) {
+    using Tree = PmrTree<int, int>;
+    CountingResource counting;
+    ResourceScope    scope(&counting);
+
+    Transient<Tree> transient;
+    for (int i = 0; i < 1000; ++i) {
+        transient.push_back(i);
+    }
+    auto t = transient.persistent();
+    ASSERT_EQ(1999, counting.allocations_);
+    ASSERT_EQ(0, counting.deallocations_);
+    ASSERT_TRUE(isBalanced(t));
+
+    counting.allocations_ = 0;
+    auto p                = Tree::empty();
+    for (int i = 0; i < 1000; ++i) {
+        p = append(i, p);
+    }
+    ASSERT_GT(counting.allocations_, 5 * 1999);
+    ASSERT_TRUE(same_fringe(t, p));
+}
+
+TEST(TransientTest, intrusiveOwnership) {
+    using Tree =
+        Tree<int, int, SizeMeasure<int>, std::allocator<int>, LocalOwnership>;
+    auto            source = Tree::from_range({1, 2, 3});
+    Transient<Tree> transient(source);
+    for (int i = 4; i <= 100; ++i) {
+        transient.push_back(i);
+    }
+    auto t = transient.persistent();
+    ASSERT_EQ(3u, source->size());
+    ASSERT_EQ(100u, t->size());
+    ASSERT_EQ(1, head(t));
+    ASSERT_EQ(100, last(t));
+    ASSERT_TRUE(isBalanced(t));
+}
+
+// Pushing onto the deep end of a spine built with 'Tree::branch' walks the
+// whole spine, whether its nodes are shared or owned by the transient.
+TEST(TransientTest, deepSpines) {
+    using Tree         = Tree<int, int>;
+    constexpr int size = 100000;
+
+    auto leftSpine  = Tree::empty();
+    auto rightSpine = Tree::empty();
+    for (int i = 0; i < size; ++i) {
+        leftSpine  = Tree::branch(leftSpine, Tree::leaf(i));
+        rightSpine = Tree::branch(Tree::leaf(size - 1 - i), rightSpine);
+    }
+
+    Transient<Tree> front(leftSpine);
+    front.push_front(-1);
+    auto shared = front.persistent();
+    ASSERT_EQ(std::size_t(size + 1), shared->size());
+    ASSERT_EQ(-1, head(shared));
+    ASSERT_EQ(0, head(leftSpine));
+
+    Transient<Tree> back(rightSpine);
+    back.push_back(size);
+    shared = back.persistent();
+    ASSERT_EQ(size, last(shared));
+    ASSERT_EQ(size - 1, last(rightSpine));
+
+    Transient<Tree> owned(std::move(leftSpine));
+    owned.push_front(-1);
+    owned.push_back(size);
+    auto t = owned.persistent();
+    ASSERT_EQ(std::size_t(size + 2), t->size());
+    ASSERT_EQ(-1, head(t));
+    ASSERT_EQ(size, last(t));
+    ASSERT_TRUE(same_fringe(tail(t), append(size, rightSpine)));
+}
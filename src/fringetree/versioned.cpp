@@ -0,0 +1,2 @@
+// versioned.cpp                                                      -*-C++-*-
+#include <fringetree/versioned.h>
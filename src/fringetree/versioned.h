@@ -0,0 +1,174 @@
+// versioned.h                                                        -*-C++-*-
+#ifndef INCLUDED_FRINGETREE_VERSIONED
+#define INCLUDED_FRINGETREE_VERSIONED
+
+#include <fringetree/fringetree.h>
+#include <fringetree/transient.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace fringetree {
+
+// One committed version of a 'Versioned' tree.  Versions are numbered from
+// 0 in commit order and never change.
+template <typename Tree>
+class Version {
+    std::uint64_t       number_;
+    typename Tree::Ptr_ root_;
+
+  public:
+    Version(std::uint64_t number, typename Tree::Ptr_ root)
+        : number_(number), root_(std::move(root)) {}
+
+    auto number() const -> std::uint64_t { return number_; }
+    auto root() const -> typename Tree::Ptr_ const& { return root_; }
+};
+
+// A tree that many threads read and update at once.  The current version is
+// published through a single atomic pointer.  A reader's snapshot is one
+// atomic load and stays valid, unchanged, however many commits follow.
+// Writers build a new tree from a snapshot without holding any lock, then
+// publish it with a compare-and-swap.  If another commit got in first, the
+// update is run again on the newer version, so update functions must be
+// free of side effects.
+//
+// The most recent 'retain' versions are kept in a history, which is only
+// touched after a commit succeeds and never by snapshots.
+//
+// With C++20's 'std::atomic<std::shared_ptr>' the current version is held in
+// one.  Before that, the free 'std::atomic_load' and
+// 'std::atomic_compare_exchange_strong' overloads are used.  Whether either
+// is lock-free is up to the standard library.  libstdc++ guards them with a
+// small pool of spin locks held only for the pointer copy, never while a
+// tree is being built.
+template <typename Tree>
+class Versioned {
+  public:
+    using Ptr_      = typename Tree::Ptr_;
+    using Snapshot_ = std::shared_ptr<Version<Tree> const>;
+
+  private:
+#if defined(__cpp_lib_atomic_shared_ptr)
+    std::atomic<Snapshot_> current_;
+
+    auto load() const -> Snapshot_ {
+        return current_.load(std::memory_order_acquire);
+    }
+
+    auto exchange(Snapshot_& expected, Snapshot_ const& next) -> bool {
+        return current_.compare_exchange_strong(expected, next);
+    }
+#else
+    Snapshot_ current_;
+
+    auto load() const -> Snapshot_ { return std::atomic_load(&current_); }
+
+    auto exchange(Snapshot_& expected, Snapshot_ const& next) -> bool {
+        return std::atomic_compare_exchange_strong(&current_, &expected, next);
+    }
+#endif
+
+    std::size_t           retain_;
+    mutable std::mutex    historyMutex_;
+    std::deque<Snapshot_> history_;
+
+    // Commits finish in number order almost always, so the insertion is
+    // nearly always at the back.
+    void remember(Snapshot_ const& version) {
+        std::lock_guard<std::mutex> lock(historyMutex_);
+        auto later = [](std::uint64_t n, Snapshot_ const& v) {
+            return n < v->number();
+        };
+        auto at = std::upper_bound(
+            history_.begin(), history_.end(), version->number(), later);
+        history_.insert(at, version);
+        while (history_.size() > retain_) {
+            history_.pop_front();
+        }
+    }
+
+    auto publish(Snapshot_& expected, Ptr_ root) -> Snapshot_ {
+        auto next = std::make_shared<Version<Tree> const>(
+            expected->number() + 1, std::move(root));
+        if (!exchange(expected, next)) {
+            return Snapshot_();
+        }
+        remember(next);
+        return next;
+    }
+
+  public:
+    explicit Versioned(Ptr_ root = Tree::empty(), std::size_t retain = 16)
+        : current_(std::make_shared<Version<Tree> const>(0, std::move(root))),
+          retain_(std::max<std::size_t>(retain, 1)) {
+        history_.push_back(load());
+    }
+
+    Versioned(Versioned const&)                    = delete;
+    auto operator=(Versioned const&) -> Versioned& = delete;
+
+    // The current version.
+    auto snapshot() const -> Snapshot_ { return load(); }
+
+    // Publishes 'root' if 'base' is still current, returning the new version,
+    // or returns null if another commit came first.
+    auto commit(Snapshot_ base, Ptr_ root) -> Snapshot_ {
+        return publish(base, std::move(root));
+    }
+
+    // Commits 'f' of the current tree, retrying on the newer version whenever
+    // another commit came first.
+    template <typename F>
+    auto update(F&& f) -> Snapshot_ {
+        auto base = load();
+        while (true) {
+            auto expected = base;
+            if (auto next = publish(expected, f(base->root()))) {
+                return next;
+            }
+            base = std::move(expected);
+        }
+    }
+
+    // Commits a batch of changes as one version.  'f' makes them through a
+    // 'Transient' over the current tree, so the batch rewrites its own new
+    // nodes in place and allocates only for what it adds.
+    template <typename F>
+    auto transact(F&& f) -> Snapshot_ {
+        return update([&](Ptr_ const& root) {
+            Transient<Tree> transient(root);
+            f(transient);
+            return transient.persistent();
+        });
+    }
+
+    // The retained versions, oldest first.
+    auto history() const -> std::vector<Snapshot_> {
+        std::lock_guard<std::mutex> lock(historyMutex_);
+        return std::vector<Snapshot_>(history_.begin(), history_.end());
+    }
+
+    // The retained version numbered 'number', or null if it has been dropped
+    // from the history or never existed.
+    auto at(std::uint64_t number) const -> Snapshot_ {
+        std::lock_guard<std::mutex> lock(historyMutex_);
+        for (auto const& v : history_) {
+            if (v->number() == number) {
+                return v;
+            }
+        }
+        return Snapshot_();
+    }
+};
+
+} // namespace fringetree
+
+#endif
@@ -0,0 +1,167 @@
+#include <fringetree/versioned.h>
+#include <fringetree/testsupport.t.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace fringetree;
+using namespace fringetree::test;
+
+TEST(VersionedTest, updateAndSnapshot) {
+    using Tree = Tree<int, int>;
+    Versioned<Tree> store;
+
+    auto v0 = store.snapshot();
+    ASSERT_EQ(0u, v0->number());
+    ASSERT_TRUE(v0->root()->isEmpty());
+
+    auto v1 = store.update([](auto t) { return append(1, t); });
+    auto v2 = store.update([](auto t) { return append(2, t); });
+    ASSERT_EQ(1u, v1->number());
+    ASSERT_EQ(2u, v2->number());
+    ASSERT_EQ(v2, store.snapshot());
+
+    // Older snapshots are unchanged by later commits.
+    ASSERT_TRUE(v0->root()->isEmpty());
+    ASSERT_EQ(std::vector<int>{1}, flatten(v1->root()));
+    ASSERT_EQ((std::vector<int>{1, 2}), flatten(v2->root()));
+}
+
+TEST(VersionedTest, commitDetectsConflicts) {
+    using Tree = Tree<int, int>;
+    Versioned<Tree> store(Tree::from_range({1, 2, 3}));
+
+    auto base = store.snapshot();
+    ASSERT_TRUE(store.commit(base, append(4, base->root())));
+    ASSERT_FALSE(store.commit(base, append(5, base->root())));
+    ASSERT_EQ((std::vector<int>{1, 2, 3, 4}),
+              flatten(store.snapshot()->root()));
+}
+
+TEST(VersionedTest, transact) {
+    using Tree = Tree<int, int>;
+    Versioned<Tree> store;
+
+    auto v = store.transact([](Transient<Tree>& t) {
+        for (int i = 0; i < 100; ++i) {
+            t.push_back(i);
+        }
+    });
+    ASSERT_EQ(1u, v->number());
+    ASSERT_EQ(100u, v->root()->size());
+    ASSERT_EQ(2u, store.history().size());
+}
+
+TEST(VersionedTest, boundedHistory) {
+    using Tree = Tree<int, int>;
+    Versioned<Tree> store(Tree::empty(), 4);
+    for (int i = 0; i < 10; ++i) {
+        store.update([i](auto t) { return append(i, t); });
+    }
+    auto history = store.history();
+    ASSERT_EQ(4u, history.size());
+    for (std::size_t i = 0; i < history.size(); ++i) {
+        ASSERT_EQ(7u + i, history[i]->number());
+        ASSERT_EQ(7u + i, history[i]->root()->size());
+    }
+    ASSERT_EQ(history[1], store.at(8));
+    ASSERT_FALSE(store.at(3));
+    ASSERT_FALSE(store.at(11));
+}
+
+TEST(VersionedTest, concurrentWriters) {
+    using Tree = Tree<int, int>;
+    Versioned<Tree> store;
+
+    constexpr int            writers = 4;
+    constexpr int            commits = 500;
+    std::atomic<bool>        done{false};
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&store, w] {
+            for (int i = 0; i < commits; ++i) {
+                store.update([&](auto t) { return append(w, t); });
+            }
+        });
+    }
+
+    // A reader sees versions in order, each as large as its number.
+    std::thread reader([&] {
+        std::uint64_t seen = 0;
+        while (!done) {
+            auto v = store.snapshot();
+            ASSERT_GE(v->number(), seen);
+            ASSERT_EQ(v->number(), v->root()->size());
+            seen = v->number();
+        }
+    });
+    for (auto& t : threads) {
+        t.join();
+    }
+    done = true;
+    reader.join();
+
+    auto v = store.snapshot();
+    ASSERT_EQ(std::uint64_t(writers * commits), v->number());
+    ASSERT_EQ(std::size_t(writers * commits), v->root()->size());
+    auto history = store.history();
+    ASSERT_EQ(16u, history.size());
+    ASSERT_EQ(v, history.back());
+}
+
+// Batches rewrite the nodes they own in place while readers on other threads
+// hold snapshots and drop them, often as the last owners of a version.  Each
+// batch pushes the values that follow the tree's current ones, so every
+// version read must hold exactly '0, 1, ..., size - 1'.
+TEST(VersionedTest, transactWithConcurrentSnapshots) {
+    using Tree = Tree<int, int>;
+    Versioned<Tree> store(Tree::empty(), 2);
+
+    constexpr int            writers = 2;
+    constexpr int            batches = 200;
+    std::atomic<bool>        done{false};
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&store] {
+            for (int i = 0; i < batches; ++i) {
+                store.transact([](Transient<Tree>& t) {
+                    for (int j = 0; j < 8; ++j) {
+                        t.push_back(int(t.size()));
+                    }
+                });
+            }
+        });
+    }
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&store, &done, r] {
+            std::vector<Versioned<Tree>::Snapshot_> held(4);
+            for (std::size_t i = 0; !done; ++i) {
+                auto& slot = held[(i * (r + 1)) % held.size()];
+                slot       = store.snapshot();
+                auto root  = slot->root();
+                ASSERT_EQ(8 * slot->number(), root->size());
+                int expected = 0;
+                for (auto v : *root) {
+                    ASSERT_EQ(expected++, v);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    done = true;
+    for (auto& t : readers) {
+        t.join();
+    }
+
+    auto v = store.snapshot();
+    ASSERT_EQ(std::uint64_t(writers * batches), v->number());
+    ASSERT_EQ(values(8 * writers * batches), flatten(v->root()));
+}